@@ -0,0 +1,164 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+using namespace std;
+
+// Benchmark driver: runs the partitioner on each netlist several times and
+// reports the median / p95 wall-clock time, the peak RSS and the cutsize.
+
+static void usage()
+{
+    fprintf(stderr, "Usage: ./bench [--reps n] [--fm path] [--fm-args \"options\"] [--csv file] <netlist> ...\n");
+    exit(1);
+}
+
+// one run of the partitioner: wall-clock seconds, peak RSS in KB, cutsize (-1 on failure)
+struct Run
+{
+    double      seconds;
+    long        peakRSS;
+    int         cutSize;
+};
+
+static Run runOnce(const string& fm, const vector<string>& fmArgs, const string& input, const string& output)
+{
+    Run run = {0, 0, -1};
+    vector<const char*> argv;
+    argv.push_back(fm.c_str());
+    for (const auto &arg : fmArgs) {
+        argv.push_back(arg.c_str());
+    }
+    argv.push_back(input.c_str());
+    argv.push_back(output.c_str());
+    argv.push_back(NULL);
+
+    const chrono::steady_clock::time_point tStart = chrono::steady_clock::now();
+    const pid_t pid = fork();
+    if (pid == 0) {
+        const int devNull = open("/dev/null", O_WRONLY);
+        dup2(devNull, STDOUT_FILENO);
+        execv(fm.c_str(), (char* const*)argv.data());
+        _exit(127);
+    }
+    int status = 0;
+    struct rusage usage;
+    if (pid < 0 || wait4(pid, &status, 0, &usage) < 0) {
+        return run;
+    }
+    run.seconds = chrono::duration<double>(chrono::steady_clock::now() - tStart).count();
+    run.peakRSS = usage.ru_maxrss;
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        return run;
+    }
+
+    // "Cutsize = N" on the first line of the result
+    ifstream result(output);
+    string line;
+    if (getline(result, line) && line.compare(0, 10, "Cutsize = ") == 0) {
+        run.cutSize = atoi(line.c_str() + 10);
+    }
+    return run;
+}
+
+// nearest-rank percentile of sorted values
+static double percentile(const vector<double>& sorted, const double p)
+{
+    const int rank = max(1, (int)ceil(p * sorted.size()));
+    return sorted[rank - 1];
+}
+
+int main(int argc, char** argv)
+{
+    int repNum = 5;
+    string fm = "bin/fm";
+    vector<string> fmArgs;
+    const char* csvFileName = NULL;
+    vector<string> inputs;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--reps") == 0 && i + 1 < argc) {
+            repNum = max(1, atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--fm") == 0 && i + 1 < argc) {
+            fm = argv[++i];
+        }
+        else if (strcmp(argv[i], "--fm-args") == 0 && i + 1 < argc) {
+            istringstream args(argv[++i]);
+            string arg;
+            while (args >> arg) {
+                fmArgs.push_back(arg);
+            }
+        }
+        else if (strcmp(argv[i], "--csv") == 0 && i + 1 < argc) {
+            csvFileName = argv[++i];
+        }
+        else if (argv[i][0] == '-' && argv[i][1] == '-') {
+            usage();
+        }
+        else {
+            inputs.push_back(argv[i]);
+        }
+    }
+    if (inputs.empty()) {
+        usage();
+    }
+
+    FILE* csv = NULL;
+    if (csvFileName != NULL) {
+        csv = fopen(csvFileName, "w");
+        if (csv == NULL) {
+            fprintf(stderr, "Cannot open the csv file \"%s\".\n", csvFileName);
+            return 1;
+        }
+        fprintf(csv, "netlist,reps,median_s,p95_s,peak_rss_mb,cutsize\n");
+    }
+    const string output = "/tmp/fm_bench_" + to_string(getpid()) + ".out";
+    printf("%-40s %10s %10s %12s %10s\n", "netlist", "median(s)", "p95(s)", "peakRSS(MB)", "cutsize");
+    int failNum = 0;
+    for (const auto &input : inputs) {
+        vector<double> seconds;
+        long peakRSS = 0;
+        int cutSize = -1;
+        bool stable = true;
+        for (int rep = 0; rep < repNum; ++rep) {
+            const Run run = runOnce(fm, fmArgs, input, output);
+            if (run.cutSize < 0) {
+                cutSize = -1;
+                break;
+            }
+            stable &= (rep == 0 || run.cutSize == cutSize);
+            cutSize = run.cutSize;
+            seconds.push_back(run.seconds);
+            peakRSS = max(peakRSS, run.peakRSS);
+        }
+        if (cutSize < 0) {
+            printf("%-40s %10s\n", input.c_str(), "failed");
+            ++failNum;
+            continue;
+        }
+        sort(seconds.begin(), seconds.end());
+        const double median = percentile(seconds, 0.5);
+        const double p95 = percentile(seconds, 0.95);
+        printf("%-40s %10.3f %10.3f %12.1f %10d%s\n", input.c_str(), median, p95,
+               peakRSS / 1024.0, cutSize, stable ? "" : " (varies)");
+        if (csv != NULL) {
+            fprintf(csv, "%s,%d,%.4f,%.4f,%.1f,%d\n", input.c_str(), repNum, median, p95, peakRSS / 1024.0, cutSize);
+        }
+    }
+    unlink(output.c_str());
+    if (csv != NULL) {
+        fclose(csv);
+    }
+    return failNum > 0;
+}
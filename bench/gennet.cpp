@@ -0,0 +1,88 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>
+
+using namespace std;
+
+// Synthetic netlist generator in the input_pa1 format. Nets connect cells
+// around a random center (with a few global pins), so that the netlists have
+// cuts far below a random one, like real designs.
+
+// max degree of the power-law distribution
+#define MAX_DEGREE      1000
+// pins of a net drawn from anywhere instead of near its center
+#define GLOBAL_PIN_RATIO 0.1
+// spread of the local pins around the center
+#define LOCAL_SPREAD    64
+
+static void usage()
+{
+    fprintf(stderr, "Usage: ./gennet <pin number> <uniform|powerlaw> <output file> [seed]\n"
+                    "  uniform:  net degree uniform in [2, 6]\n"
+                    "  powerlaw: P(degree) ~ degree^-2.5 in [2, %d]\n", MAX_DEGREE);
+    exit(1);
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 4 || argc > 5) {
+        usage();
+    }
+    const long long pinNum = atoll(argv[1]);
+    const bool powerLaw = strcmp(argv[2], "powerlaw") == 0;
+    if (pinNum < 2 || (!powerLaw && strcmp(argv[2], "uniform") != 0)) {
+        usage();
+    }
+    mt19937_64 rng(argc == 5 ? strtoull(argv[4], NULL, 10) : 1);
+
+    // degree distributions with a mean of about 4
+    vector<double> weight;
+    for (int d = 2; d <= MAX_DEGREE; ++d) {
+        weight.push_back(pow(d, -2.5));
+    }
+    discrete_distribution<int> powerDegree(weight.begin(), weight.end());
+    uniform_int_distribution<int> uniformDegree(2, 6);
+    const int cellNum = max(2LL, pinNum / 4);
+    uniform_int_distribution<int> anyCell(0, cellNum - 1);
+    normal_distribution<double> spread(0, LOCAL_SPREAD);
+    bernoulli_distribution global(GLOBAL_PIN_RATIO);
+
+    FILE* out = fopen(argv[3], "w");
+    if (out == NULL) {
+        fprintf(stderr, "Cannot open the output file \"%s\".\n", argv[3]);
+        return 1;
+    }
+    string buff = "0.1\n";
+    vector<int> pins;
+    long long pinCount = 0;
+    for (int net = 1; pinCount < pinNum; ++net) {
+        const int degree = min((long long)(powerLaw ? powerDegree(rng) + 2 : uniformDegree(rng)), pinNum - pinCount);
+        const int center = anyCell(rng);
+        pins.clear();
+        for (int tryNum = 0; (int)pins.size() < max(degree, 2) && tryNum < 8 * degree; ++tryNum) {
+            int cell = global(rng) ? anyCell(rng) : center + (int)lround(spread(rng));
+            cell = min(max(cell, 0), cellNum - 1);
+            if (find(pins.begin(), pins.end(), cell) == pins.end()) {
+                pins.push_back(cell);
+            }
+        }
+        buff += "NET n" + to_string(net);
+        for (const auto &cell : pins) {
+            buff += " c" + to_string(cell + 1);
+        }
+        buff += " ;\n";
+        pinCount += pins.size();
+        if (buff.size() > (1 << 20)) {
+            fwrite(buff.data(), 1, buff.size(), out);
+            buff.clear();
+        }
+    }
+    fwrite(buff.data(), 1, buff.size(), out);
+    fclose(out);
+    return 0;
+}
@@ -0,0 +1,120 @@
+#include <algorithm>
+#include "coarsener.h"
+
+using namespace std;
+
+// nets larger than this do not vote for matching partners
+#define MATCH_NET_SIZE 50
+
+
+int Coarsener::coarsen(Hypergraph& coarse, vector<int>& cellMap, mt19937& rng) const
+{
+    const int coarseNum = match(cellMap, rng);
+    contract(coarse, cellMap, coarseNum);
+    return coarseNum;
+}
+
+int Coarsener::match(vector<int>& cellMap, mt19937& rng) const
+{
+    const int cellNum = _fine.getCellNum();
+    cellMap.assign(cellNum, -1);
+
+    // visit cells in random order
+    vector<int> order(cellNum);
+    for (int c = 0; c < cellNum; ++c) {
+        order[c] = c;
+    }
+    shuffle(order.begin(), order.end(), rng);
+
+    // heavy-edge rating: sum of w(e)/(|e|-1) over the nets two cells share
+    vector<double> rating(cellNum, 0);
+    vector<int> touched;
+    int coarseNum = 0;
+    for (int i = 0; i < cellNum; ++i) {
+        const int u = order[i];
+        if (cellMap[u] != -1) {
+            continue;
+        }
+        if (isFixed(u)) {
+            cellMap[u] = coarseNum++;
+            continue;
+        }
+        const int weightU = _fine.getCellWeight(u);
+        for (const auto &net : _fine.getNetList(u)) {
+            const IdRange cellList = _fine.getCellList(net);
+            if (cellList.size() < 2 || cellList.size() > MATCH_NET_SIZE) {
+                continue;
+            }
+            const double score = (double)_fine.getNetWeight(net) / (cellList.size() - 1);
+            for (const auto &v : cellList) {
+                if (v != u && cellMap[v] == -1 && !isFixed(v)
+                    && weightU + _fine.getCellWeight(v) <= _maxCellWeight) {
+                    if (rating[v] == 0) {
+                        touched.push_back(v);
+                    }
+                    rating[v] += score;
+                }
+            }
+        }
+
+        int best = -1;
+        double bestRating = 0;
+        for (const auto &v : touched) {
+            if (rating[v] > bestRating) {
+                bestRating = rating[v];
+                best = v;
+            }
+            rating[v] = 0;
+        }
+        touched.clear();
+
+        cellMap[u] = coarseNum;
+        if (best != -1) {
+            cellMap[best] = coarseNum;
+        }
+        ++coarseNum;
+    }
+    return coarseNum;
+}
+
+void Coarsener::contract(Hypergraph& coarse, const vector<int>& cellMap, const int coarseNum) const
+{
+    coarse.clear();
+
+    // coarse cell weights
+    vector<int> weight(coarseNum, 0);
+    for (int c = 0, end = _fine.getCellNum(); c < end; ++c) {
+        weight[cellMap[c]] += _fine.getCellWeight(c);
+    }
+
+    // coarse nets: distinct coarse pins, nets left with a single pin can never be cut
+    vector<int> lastNet(coarseNum, -1);
+    vector<int> pins;
+    vector<int> netWeight;
+    for (int n = 0, end = _fine.getNetNum(); n < end; ++n) {
+        pins.clear();
+        for (const auto &c : _fine.getCellList(n)) {
+            const int cc = cellMap[c];
+            if (lastNet[cc] != n) {
+                lastNet[cc] = n;
+                pins.push_back(cc);
+            }
+        }
+        if (pins.size() < 2) {
+            continue;
+        }
+        for (const auto &cc : pins) {
+            coarse.addPin(cc);
+        }
+        coarse.closeNet();
+        if (_fine.isNetWeighted()) {
+            netWeight.push_back(_fine.getNetWeight(n));
+        }
+    }
+    coarse.finalize(coarseNum);
+    coarse.setCellWeights(weight);
+    if (_fine.isNetWeighted()) {
+        coarse.setNetWeights(netWeight);
+    }
+    return;
+}
@@ -0,0 +1,35 @@
+#ifndef COARSENER_H
+#define COARSENER_H
+
+#include <random>
+#include <vector>
+#include "hypergraph.h"
+using namespace std;
+
+// One level of multilevel coarsening: heavy-edge matching of cell pairs,
+// contracted into a coarser hypergraph with summed cell weights.
+class Coarsener
+{
+public:
+    // Constructor and destructor (fixed cells, fixedPart >= 0, are never matched)
+    Coarsener(const Hypergraph& fine, const int maxCellWeight, const vector<int>* fixedPart = NULL) :
+        _fine(fine), _maxCellWeight(maxCellWeight),
+        _fixedPart((fixedPart != NULL && !fixedPart->empty()) ? fixedPart : NULL) { }
+    ~Coarsener() { }
+
+    // Contract _fine into "coarse"; cellMap[fine cell] = coarse cell.
+    // Returns the number of coarse cells.
+    int coarsen(Hypergraph& coarse, vector<int>& cellMap, mt19937& rng) const;
+
+private:
+    const Hypergraph&   _fine;          // hypergraph to be coarsened
+    int                 _maxCellWeight; // max weight of a coarse cell
+    const vector<int>*  _fixedPart;     // fixed part of each cell (NULL if none is fixed)
+
+    bool isFixed(const int c) const     { return _fixedPart != NULL && (*_fixedPart)[c] >= 0; }
+
+    int match(vector<int>& cellMap, mt19937& rng) const;
+    void contract(Hypergraph& coarse, const vector<int>& cellMap, const int coarseNum) const;
+};
+
+#endif  // COARSENER_H
@@ -0,0 +1,86 @@
+#ifndef CSR_H
+#define CSR_H
+
+#include <vector>
+using namespace std;
+
+class IdRange
+{
+public:
+    // Constructor and destructor
+    IdRange(const int* begin, const int* end) :
+        _begin(begin), _end(end) { }
+    ~IdRange() { }
+
+    // Basic access methods
+    const int* begin() const            { return _begin; }
+    const int* end() const              { return _end; }
+    int size() const                    { return (int)(_end - _begin); }
+    bool empty() const                  { return _begin == _end; }
+    int operator[](const int i) const   { return _begin[i]; }
+
+private:
+    const int*  _begin;     // first id of the range
+    const int*  _end;       // one past the last id of the range
+};
+
+// compressed sparse row adjacency: ids of row r are pin[offset[r], offset[r+1])
+class CSRList
+{
+public:
+    // Constructor and destructor
+    CSRList() : _offset(1, 0) { }
+    ~CSRList() { }
+
+    // Basic access methods
+    int getRowNum() const               { return (int)_offset.size() - 1; }
+    int getPinNum() const               { return (int)_pin.size(); }
+    int getRowSize(const int r) const   { return _offset[r+1] - _offset[r]; }
+    const vector<int>& getOffsets() const   { return _offset; }
+    const vector<int>& getPins() const      { return _pin; }
+    IdRange operator[](const int r) const {
+        const int* const base = _pin.data();
+        return IdRange(base + _offset[r], base + _offset[r+1]);
+    }
+
+    // Modify methods
+    void clear()                    { _offset.assign(1, 0); _pin.clear(); }
+    void reserve(const int rowNum, const size_t pinNum) {
+        _offset.reserve(rowNum + 1);
+        _pin.reserve(pinNum);
+    }
+    void addPin(const int id)       { _pin.push_back(id); }
+    void closeRow()                 { _offset.push_back((int)_pin.size()); }
+    void assign(const int* offset, const int rowNum, const int* pin, const int pinNum) {
+        _offset.assign(offset, offset + rowNum + 1);
+        _pin.assign(pin, pin + pinNum);
+    }
+    void assign(vector<int>&& offset, vector<int>&& pin) {
+        _offset = std::move(offset);
+        _pin = std::move(pin);
+    }
+
+    // build the transposed adjacency (column -> rows) of "src" with "colNum" columns
+    void transpose(const CSRList& src, const int colNum) {
+        _offset.assign(colNum + 1, 0);
+        _pin.resize(src._pin.size());
+        for (size_t i = 0, end = src._pin.size(); i < end; ++i) {
+            ++_offset[src._pin[i] + 1];
+        }
+        for (int c = 0; c < colNum; ++c) {
+            _offset[c + 1] += _offset[c];
+        }
+        vector<int> fill(_offset.begin(), _offset.end() - 1);
+        for (int r = 0, end = src.getRowNum(); r < end; ++r) {
+            for (int k = src._offset[r]; k < src._offset[r + 1]; ++k) {
+                _pin[fill[src._pin[k]]++] = r;
+            }
+        }
+    }
+
+private:
+    vector<int>     _offset;    // row r spans [_offset[r], _offset[r+1]) of _pin
+    vector<int>     _pin;       // concatenated ids of all rows
+};
+
+#endif  // CSR_H
@@ -0,0 +1,61 @@
+#include <algorithm>
+#include "gainbuckets.h"
+
+using namespace std;
+
+// the bucket arrays of all lists may hold up to this many buckets, or 2 per
+// node: beyond that (large net weights) the buckets are kept in maps
+#define DENSE_BUCKET_MIN    (1 << 16)
+
+
+void GainBuckets::init(const int listNum, const int nodeNum, const int maxGain)
+{
+    _maxGain = maxGain;
+    const size_t bucketNum = (2 * (size_t)maxGain + 1) * listNum;
+    _sparse = (bucketNum > max((size_t)DENSE_BUCKET_MIN, 2 * (size_t)nodeNum));
+    if (_sparse) {
+        vector<vector<int> >().swap(_bList);
+        _sparseList.assign(listNum, map<int, int>());
+    }
+    else {
+        _sparseList.clear();
+        _bList.resize(listNum);
+        for (auto &bList : _bList) {
+            bList.assign(2*maxGain+1, NIL_CELL);
+        }
+    }
+    _topGain.assign(listNum, -maxGain-1);
+    if ((int)_next.size() != nodeNum) {
+        _prev.assign(nodeNum, NIL_CELL);
+        _next.assign(nodeNum, NIL_CELL);
+    }
+}
+
+int GainBuckets::getSparseFirst(const int list, const int gain) const
+{
+    const map<int, int>::const_iterator it = _sparseList[list].find(gain);
+    return (it == _sparseList[list].end()) ? NIL_CELL : it->second;
+}
+
+int GainBuckets::getSparseLowerGain(const int list, const int gain) const
+{
+    map<int, int>::const_iterator it = _sparseList[list].lower_bound(gain);
+    if (it == _sparseList[list].begin()) {
+        return -_maxGain-1;
+    }
+    return (--it)->first;
+}
+
+void GainBuckets::removeSparseHead(const int list, const int next, const int gain)
+{
+    if (next != NIL_CELL) {
+        _sparseList[list][gain] = next;
+        _prev[next] = NIL_CELL;
+        return;
+    }
+    // bucket becomes empty => drop it, the max gain is the next one below
+    _sparseList[list].erase(gain);
+    if (gain == _topGain[list]) {
+        _topGain[list] = _sparseList[list].empty() ? -_maxGain-1 : _sparseList[list].rbegin()->first;
+    }
+}
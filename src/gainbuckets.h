@@ -0,0 +1,99 @@
+#ifndef GAINBUCKETS_H
+#define GAINBUCKETS_H
+
+#include <map>
+#include <vector>
+#include "partitionstate.h"
+using namespace std;
+
+// FM bucket lists: "listNum" lists (one per party / destination part), each
+// an array of 2*Pmax+1 buckets of nodes indexed by gain+Pmax. A node is an
+// id in [0, nodeNum) (a cell, or cell*k+part) and sits in at most one list,
+// so all lists share one pair of links per node.
+// Large net weights make Pmax, and so the arrays, large: past a bound of the
+// node number the buckets of each list are kept in a map keyed by gain.
+class GainBuckets
+{
+public:
+    // Constructor and destructor
+    GainBuckets() : _maxGain(0), _sparse(false) { }
+    ~GainBuckets() { }
+
+    // empty lists for gains in [-maxGain, maxGain]
+    // (the links are only written by add(), so they are kept between passes)
+    void init(const int listNum, const int nodeNum, const int maxGain);
+
+    // Basic access methods
+    bool isSparse() const                       { return _sparse; }
+    bool isEmpty(const int list) const          { return _topGain[list] < -_maxGain; }
+    int getTopGain(const int list) const        { return _topGain[list]; }     // max non-empty gain
+    int getFirst(const int list, const int gain) const {
+        return _sparse ? getSparseFirst(list, gain) : _bList[list][gain+_maxGain];
+    }
+    int getNext(const int node) const           { return _next[node]; }
+    // next non-empty gain below "gain" (< -Pmax if none)
+    int getLowerGain(const int list, int gain) const {
+        if (_sparse) {
+            return getSparseLowerGain(list, gain);
+        }
+        for (--gain; gain >= -_maxGain && _bList[list][gain+_maxGain] == NIL_CELL; --gain) { }
+        return gain;
+    }
+
+    // Modify methods
+    void add(const int list, const int node, const int gain) {
+        int& head = _sparse ? _sparseList[list].emplace(gain, NIL_CELL).first->second : _bList[list][gain+_maxGain];
+        // bList -> [node] (-> node)
+        _next[node] = head;
+        _prev[node] = NIL_CELL;
+        if (head != NIL_CELL) {
+            _prev[head] = node;
+        }
+        head = node;
+        if (gain > _topGain[list]) {
+            _topGain[list] = gain;
+        }
+    }
+    void remove(const int list, const int node, const int gain) {
+        const int next = _next[node];
+        const int prev = _prev[node];
+        // bList -> node -> [node] (-> node)
+        if (prev != NIL_CELL) {
+            _next[prev] = next;
+            if (next != NIL_CELL) {
+                _prev[next] = prev;
+            }
+        }
+        // bList -> [node] (-> node)
+        else if (_sparse) {
+            removeSparseHead(list, next, gain);
+        }
+        else {
+            _bList[list][gain+_maxGain] = next;
+            if (next != NIL_CELL) {
+                _prev[next] = NIL_CELL;
+            }
+            // bucket becomes empty => walk down to the next non-empty gain
+            else if (gain == _topGain[list]) {
+                _topGain[list] = getLowerGain(list, gain);
+            }
+        }
+        _next[node] = NIL_CELL;
+        _prev[node] = NIL_CELL;
+    }
+
+private:
+    int                     _maxGain;       // Pmax: gains lie in [-Pmax, Pmax]
+    bool                    _sparse;        // buckets kept in _sparseList instead of _bList
+    vector<vector<int> >    _bList;         // head node of each bucket of each list, indexed by gain+Pmax
+    vector<map<int, int> >  _sparseList;    // head node of each non-empty bucket of each list, by gain
+    vector<int>             _topGain;       // max non-empty gain of each list (< -Pmax if empty)
+    vector<int>             _prev;          // previous node in the same bucket
+    vector<int>             _next;          // next node in the same bucket
+
+    int getSparseFirst(const int list, const int gain) const;
+    int getSparseLowerGain(const int list, const int gain) const;
+    void removeSparseHead(const int list, const int next, const int gain);
+};
+
+#endif  // GAINBUCKETS_H
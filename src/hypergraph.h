@@ -0,0 +1,114 @@
+#ifndef HYPERGRAPH_H
+#define HYPERGRAPH_H
+
+#include <algorithm>
+#include <vector>
+#include "csr.h"
+using namespace std;
+
+// Immutable connectivity of a netlist: cell <-> net adjacency in CSR form
+// and optional cell / net weights (unit weights when none are given).
+class Hypergraph
+{
+public:
+    // Constructor and destructor
+    Hypergraph() : _cellNum(0), _maxPinNum(0), _maxNetSize(0), _maxGain(0), _totalWeight(0), _totalNetWeight(0) { }
+    ~Hypergraph() { }
+
+    // Basic access methods
+    int getCellNum() const                  { return _cellNum; }
+    int getNetNum() const                   { return _netCells.getRowNum(); }
+    int getPinNum() const                   { return _netCells.getPinNum(); }
+    int getMaxPinNum() const                { return _maxPinNum; }
+    int getMaxNetSize() const               { return _maxNetSize; }
+    long long getMaxGain() const            { return _maxGain; }
+    long long getTotalWeight() const        { return _totalWeight; }
+    long long getTotalNetWeight() const     { return _totalNetWeight; }
+    bool isWeighted() const                 { return !_cellWeight.empty(); }
+    bool isNetWeighted() const              { return !_netWeight.empty(); }
+    int getCellWeight(const int c) const    { return _cellWeight.empty() ? 1 : _cellWeight[c]; }
+    int getNetWeight(const int n) const     { return _netWeight.empty() ? 1 : _netWeight[n]; }
+    const vector<int>& getCellWeights() const   { return _cellWeight; }
+    const vector<int>& getNetWeights() const    { return _netWeight; }
+    IdRange getNetList(const int c) const   { return _cellNets[c]; }
+    IdRange getCellList(const int n) const  { return _netCells[n]; }
+    int getNetSize(const int n) const       { return _netCells.getRowSize(n); }
+    const CSRList& getCellNets() const      { return _cellNets; }
+    const CSRList& getNetCells() const      { return _netCells; }
+
+    // Build methods: add the pins of every net, close it, then finalize
+    void addPin(const int cellId)   { _netCells.addPin(cellId); }
+    void closeNet()                 { _netCells.closeRow(); }
+    // (buildCellNets is false when both lists were filled directly, e.g. from a cache)
+    void finalize(const int cellNum, const bool buildCellNets = true) {
+        _cellNum = cellNum;
+        if (buildCellNets) {
+            _cellNets.transpose(_netCells, cellNum);
+        }
+        update();
+    }
+    CSRList& getCellNets()  { return _cellNets; }
+    CSRList& getNetCells()  { return _netCells; }
+    void setCellWeights(const vector<int>& weight) {
+        _cellWeight = weight;
+        update();
+    }
+    void setNetWeights(const vector<int>& weight) {
+        _netWeight = weight;
+        update();
+    }
+    void clear() {
+        _cellNum = 0;
+        _cellNets.clear();
+        _netCells.clear();
+        _cellWeight.clear();
+        _netWeight.clear();
+        update();
+    }
+
+private:
+    int             _cellNum;       // number of cells
+    int             _maxPinNum;     // max number of nets on a cell
+    int             _maxNetSize;    // max number of cells on a net
+    long long       _maxGain;       // Pmax: max sum of net weights on a cell (bounds any gain)
+    long long       _totalWeight;   // sum of cell weights
+    long long       _totalNetWeight; // sum of net weights (bounds any cut)
+    CSRList         _cellNets;      // cell -> net adjacency
+    CSRList         _netCells;      // net -> cell adjacency
+    vector<int>     _cellWeight;    // weight of each cell (empty = unit weights)
+    vector<int>     _netWeight;     // weight of each net (empty = unit weights)
+
+    // recompute the max pin number / net size, Pmax and the total weights
+    // (in 64 bits: users check them against the int gains / cuts they keep)
+    void update() {
+        _maxPinNum = 0;
+        _maxNetSize = 0;
+        for (int n = 0, end = getNetNum(); n < end; ++n) {
+            _maxNetSize = max(_maxNetSize, _netCells.getRowSize(n));
+        }
+        _maxGain = 0;
+        _totalWeight = 0;
+        _totalNetWeight = _netWeight.empty() ? getNetNum() : 0;
+        for (const auto &weight : _netWeight) {
+            _totalNetWeight += weight;
+        }
+        for (int c = 0; c < _cellNum; ++c) {
+            if (_cellNets.getRowSize(c) > _maxPinNum) {
+                _maxPinNum = _cellNets.getRowSize(c);
+            }
+            long long gain = _cellNets.getRowSize(c);
+            if (!_netWeight.empty()) {
+                gain = 0;
+                for (const auto &n : _cellNets[c]) {
+                    gain += _netWeight[n];
+                }
+            }
+            if (gain > _maxGain) {
+                _maxGain = gain;
+            }
+            _totalWeight += getCellWeight(c);
+        }
+    }
+};
+
+#endif  // HYPERGRAPH_H
@@ -0,0 +1,272 @@
+#include <algorithm>
+#include <cstring>
+#include <queue>
+#include "initpartitioner.h"
+
+using namespace std;
+
+// label propagation: max rounds, and nets larger than this do not vote
+#define LP_ROUND_NUM    8
+#define LP_NET_SIZE     50
+
+static const char* const INIT_NAME[INIT_METHOD_NUM] = { "order", "random", "grow", "lp" };
+
+
+int InitPartitioner::find(const char* name)
+{
+    for (int m = 0; m < INIT_METHOD_NUM; ++m) {
+        if (strcmp(name, INIT_NAME[m]) == 0) {
+            return m;
+        }
+    }
+    return -1;
+}
+
+void InitPartitioner::random(mt19937& rng, vector<unsigned char>& assign) const
+{
+    const int cellNum = _graph.getCellNum();
+    vector<int> order(cellNum);
+    for (int c = 0; c < cellNum; ++c) {
+        order[c] = c;
+    }
+    shuffle(order.begin(), order.end(), rng);
+    assign.assign(cellNum, 0);
+    int partWeight[2] = {0, 0};
+    for (const auto &c : order) {
+        const bool party = partWeight[1]*_ratio < partWeight[0]*(1-_ratio);
+        assign[c] = party;
+        partWeight[party] += _graph.getCellWeight(c);
+    }
+}
+
+int InitPartitioner::farCell(const int start) const
+{
+    // last cell reached by a BFS from "start" (nets too large to vote are not followed)
+    vector<unsigned char> cellSeen(_graph.getCellNum(), 0);
+    vector<unsigned char> netSeen(_graph.getNetNum(), 0);
+    vector<int> queue(1, start);
+    cellSeen[start] = 1;
+    for (size_t head = 0; head < queue.size(); ++head) {
+        for (const auto &net : _graph.getNetList(queue[head])) {
+            if (netSeen[net] || _graph.getNetSize(net) > LP_NET_SIZE) {
+                continue;
+            }
+            netSeen[net] = 1;
+            for (const auto &v : _graph.getCellList(net)) {
+                if (!cellSeen[v]) {
+                    cellSeen[v] = 1;
+                    queue.push_back(v);
+                }
+            }
+        }
+    }
+    return queue.back();
+}
+
+void InitPartitioner::grow(mt19937& rng, vector<unsigned char>& assign) const
+{
+    const int cellNum = _graph.getCellNum();
+    assign.assign(cellNum, 1);
+    if (cellNum == 0) {
+        return;
+    }
+
+    // gain[v]: cut decrease if B cell v joined A, kept in a max-heap with
+    // lazy deletion (an entry is stale when its gain differs from gain[v])
+    vector<int> countA(_graph.getNetNum(), 0);
+    vector<int> gain(cellNum, 0);
+    vector<unsigned char> done(cellNum, 0);     // in A, or fixed in B
+    priority_queue<pair<int, int> > heap;
+    // contribution of a net with k cells in A to the gain of each of its B cells
+    auto term = [](const int k, const int size, const int weight) {
+        return (k == size - 1 ? weight : 0) - (k == 0 ? weight : 0);
+    };
+    for (int n = 0, end = _graph.getNetNum(); n < end; ++n) {
+        const int delta = term(0, _graph.getNetSize(n), _graph.getNetWeight(n));
+        for (const auto &v : _graph.getCellList(n)) {
+            gain[v] += delta;
+        }
+    }
+
+    double weightA = 0;
+    auto addToA = [&](const int c) {
+        assign[c] = 0;
+        done[c] = 1;
+        weightA += _graph.getCellWeight(c);
+        for (const auto &net : _graph.getNetList(c)) {
+            const int size = _graph.getNetSize(net);
+            const int weight = _graph.getNetWeight(net);
+            const int k = countA[net]++;
+            const int delta = term(k + 1, size, weight) - term(k, size, weight);
+            if (delta == 0) {
+                continue;
+            }
+            for (const auto &v : _graph.getCellList(net)) {
+                if (!done[v]) {
+                    gain[v] += delta;
+                    heap.push(make_pair(gain[v], v));
+                }
+            }
+        }
+    };
+
+    // fixed cells of A seed the region, fixed cells of B never join it
+    for (int c = 0; c < cellNum; ++c) {
+        if (isFixed(c)) {
+            if ((*_fixedPart)[c] == 0) {
+                addToA(c);
+            }
+            else {
+                done[c] = 1;
+            }
+        }
+    }
+
+    // when the frontier runs dry (first seed, next component) restart from
+    // the next free cell of a random order
+    vector<int> order(cellNum);
+    for (int c = 0; c < cellNum; ++c) {
+        order[c] = c;
+    }
+    shuffle(order.begin(), order.end(), rng);
+    size_t next = 0;
+    bool first = true;
+    const double target = _ratio * _graph.getTotalWeight();
+    while (weightA < target) {
+        int c = -1;
+        while (!heap.empty()) {
+            const pair<int, int> top = heap.top();
+            heap.pop();
+            if (!done[top.second] && gain[top.second] == top.first) {
+                c = top.second;
+                break;
+            }
+        }
+        while (c == -1 && next < order.size()) {
+            if (!done[order[next]]) {
+                c = order[next];
+                if (first) {
+                    const int far = farCell(c);
+                    c = done[far] ? c : far;
+                    first = false;
+                }
+            }
+            ++next;
+        }
+        if (c == -1) {
+            break;
+        }
+        addToA(c);
+    }
+}
+
+void InitPartitioner::propagate(mt19937& rng, const int maxClusterWeight, vector<unsigned char>& assign) const
+{
+    const int cellNum = _graph.getCellNum();
+    vector<int> label(cellNum);
+    vector<int> clusterWeight(cellNum);
+    vector<int> order(cellNum);
+    for (int c = 0; c < cellNum; ++c) {
+        label[c] = c;
+        clusterWeight[c] = _graph.getCellWeight(c);
+        order[c] = c;
+    }
+    shuffle(order.begin(), order.end(), rng);
+
+    // each free cell takes the label with the highest w(e)/(|e|-1) rating
+    // among its neighbors, if the cluster stays light enough
+    vector<double> score(cellNum, 0);
+    vector<int> touched;
+    for (int round = 0; round < LP_ROUND_NUM; ++round) {
+        int changeNum = 0;
+        for (const auto &u : order) {
+            if (isFixed(u)) {
+                continue;
+            }
+            for (const auto &net : _graph.getNetList(u)) {
+                const IdRange cellList = _graph.getCellList(net);
+                if (cellList.size() < 2 || cellList.size() > LP_NET_SIZE) {
+                    continue;
+                }
+                const double rating = (double)_graph.getNetWeight(net) / (cellList.size() - 1);
+                for (const auto &v : cellList) {
+                    if (v != u && !isFixed(v)) {
+                        if (score[label[v]] == 0) {
+                            touched.push_back(label[v]);
+                        }
+                        score[label[v]] += rating;
+                    }
+                }
+            }
+            const int weight = _graph.getCellWeight(u);
+            int best = label[u];
+            double bestScore = score[best];
+            for (const auto &l : touched) {
+                if (score[l] > bestScore && clusterWeight[l] + weight <= maxClusterWeight) {
+                    best = l;
+                    bestScore = score[l];
+                }
+                score[l] = 0;
+            }
+            touched.clear();
+            if (best != label[u]) {
+                clusterWeight[label[u]] -= weight;
+                clusterWeight[best] += weight;
+                label[u] = best;
+                ++changeNum;
+            }
+        }
+        if (changeNum == 0) {
+            break;
+        }
+    }
+
+    // fill A with whole clusters in the order a BFS over the cells reaches
+    // them, so that neighboring clusters end up on the same side
+    assign.assign(cellNum, 1);
+    double weightA = 0;
+    for (int c = 0; c < cellNum; ++c) {
+        if (isFixed(c)) {
+            assign[c] = (*_fixedPart)[c];
+            weightA += (assign[c] == 0) ? _graph.getCellWeight(c) : 0;
+        }
+    }
+    const double target = _ratio * _graph.getTotalWeight();
+    vector<int> clusterParty(cellNum, -1);
+    vector<unsigned char> cellSeen(cellNum, 0);
+    vector<unsigned char> netSeen(_graph.getNetNum(), 0);
+    vector<int> queue;
+    queue.reserve(cellNum);
+    size_t head = 0;
+    for (const auto &start : order) {
+        if (cellSeen[start]) {
+            continue;
+        }
+        cellSeen[start] = 1;
+        queue.push_back(start);
+        for (; head < queue.size(); ++head) {
+            const int u = queue[head];
+            if (!isFixed(u) && clusterParty[label[u]] == -1) {
+                clusterParty[label[u]] = (weightA >= target);
+                weightA += (weightA >= target) ? 0 : clusterWeight[label[u]];
+            }
+            for (const auto &net : _graph.getNetList(u)) {
+                if (netSeen[net] || _graph.getNetSize(net) > LP_NET_SIZE) {
+                    continue;
+                }
+                netSeen[net] = 1;
+                for (const auto &v : _graph.getCellList(net)) {
+                    if (!cellSeen[v]) {
+                        cellSeen[v] = 1;
+                        queue.push_back(v);
+                    }
+                }
+            }
+        }
+    }
+    for (int c = 0; c < cellNum; ++c) {
+        if (!isFixed(c)) {
+            assign[c] = clusterParty[label[c]];
+        }
+    }
+}
@@ -0,0 +1,52 @@
+#ifndef INITPARTITIONER_H
+#define INITPARTITIONER_H
+
+#include <random>
+#include <vector>
+#include "hypergraph.h"
+using namespace std;
+
+// generator of the initial 2-way solution of a flat FM run
+enum InitMethod
+{
+    INIT_ORDER,     // first cells in parse order go to B, the rest to A
+    INIT_RANDOM,    // seeded random balanced assignment
+    INIT_GROW,      // greedy hypergraph growing of A from a seed cell
+    INIT_LP,        // label propagation clusters packed into A and B
+    INIT_METHOD_NUM
+};
+
+// Initial 2-way solutions (0 = A, 1 = B) with a target share "ratio" of A
+// in the total cell weight.
+class InitPartitioner
+{
+public:
+    // Constructor and destructor (fixed cells, fixedPart >= 0, keep their part)
+    InitPartitioner(const Hypergraph& graph, const double ratio, const vector<int>* fixedPart = NULL) :
+        _graph(graph), _ratio(ratio),
+        _fixedPart((fixedPart != NULL && !fixedPart->empty()) ? fixedPart : NULL) { }
+    ~InitPartitioner() { }
+
+    // method of a name ("order", "random", "grow", "lp"), -1 if unknown
+    static int find(const char* name);
+
+    // cells in random order go to the lighter party (fixed cells are left to the caller)
+    void random(mt19937& rng, vector<unsigned char>& assign) const;
+    // grow A from a pseudo-peripheral cell, taking the frontier cell that cuts
+    // the fewest nets, until A reaches its share
+    void grow(mt19937& rng, vector<unsigned char>& assign) const;
+    // clusters of at most maxClusterWeight found by label propagation,
+    // placed in BFS order into A until it reaches its share
+    void propagate(mt19937& rng, const int maxClusterWeight, vector<unsigned char>& assign) const;
+
+private:
+    const Hypergraph&   _graph;         // hypergraph to be partitioned
+    double              _ratio;         // target share of A(0) in the total cell weight
+    const vector<int>*  _fixedPart;     // fixed part of each cell (NULL if none is fixed)
+
+    bool isFixed(const int c) const     { return _fixedPart != NULL && (*_fixedPart)[c] >= 0; }
+
+    int farCell(const int start) const;
+};
+
+#endif  // INITPARTITIONER_H
@@ -0,0 +1,248 @@
+#include <climits>
+#include <algorithm>
+#include "kwayrefiner.h"
+
+using namespace std;
+
+// candidates inspected per destination part when the best ones are unmovable
+#define SELECT_SCAN_NUM 32
+
+
+KWayRefiner::KWayRefiner(const Hypergraph& graph, const int partNum, const double bFactor) :
+    _graph(graph), _partNum(partNum), _cellNum(graph.getCellNum()), _netNum(graph.getNetNum()),
+    _maxPinNum(graph.getMaxGain()), _cutSize(0), _initCutSize(0), _iterNum(0), _maxIterNum(0)
+{
+    const double avgWeight = (double)graph.getTotalWeight() / partNum;
+    _minWeight = (1 - bFactor) * avgWeight;
+    _maxWeight = (1 + bFactor) * avgWeight;
+}
+
+bool KWayRefiner::isBalanced() const
+{
+    for (int p = 0; p < _partNum; ++p) {
+        if (_partWeight[p] < _minWeight || _partWeight[p] > _maxWeight) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void KWayRefiner::refine(const vector<int>& part)
+{
+    init(part);
+    _iterNum = 0;
+    while (1) {
+        ++_iterNum;
+        initGains();
+        _moveStack.clear();
+        _fromStack.clear();
+
+        // FM pass: move the best movable cell until none is left, remember the best prefix
+        const int startCut = _cutSize;
+        int bestCut = _cutSize;
+        int bestMoveNum = 0;
+        const int maxMoveNum = (_passLimit.moveRatio > 0) ? max(1, (int)(_passLimit.moveRatio*_cellNum)) : INT_MAX;
+        const int stallMoveNum = (_passLimit.stallMoveNum > 0) ? _passLimit.stallMoveNum : INT_MAX;
+        int cellId, to;
+        while (selectMove(cellId, to)) {
+            // lock the cell: it leaves every bucket list
+            _lock[cellId] = 1;
+            for (int p = 0; p < _partNum; ++p) {
+                if (p != _part[cellId]) {
+                    rmNode(cellId, p);
+                }
+            }
+            _moveStack.push_back(cellId);
+            _fromStack.push_back(_part[cellId]);
+            moveCell(cellId, to, true);
+            STATS_COUNT(_stats, COUNT_MOVE, 1);
+
+            const int moveNum = _moveStack.size();
+            if (_cutSize < bestCut) {
+                bestCut = _cutSize;
+                bestMoveNum = moveNum;
+            }
+            if (moveNum - bestMoveNum >= stallMoveNum || moveNum >= maxMoveNum) {
+                break;
+            }
+        }
+
+        // recover to the best prefix (gains are rebuilt by the next pass)
+        STATS_COUNT(_stats, COUNT_ROLLBACK, (int)_moveStack.size() - bestMoveNum);
+        for (int round = (int)_moveStack.size() - 1; round >= bestMoveNum; --round) {
+            moveCell(_moveStack[round], _fromStack[round], false);
+        }
+        if (bestCut == startCut || _iterNum == _maxIterNum) {
+            return;
+        }
+    }
+}
+
+void KWayRefiner::init(const vector<int>& part)
+{
+    _part = part;
+    _partWeight.assign(_partNum, 0);
+    _partCount.assign((size_t)_netNum * _partNum, 0);
+    _spanNum.assign(_netNum, 0);
+    _lock.assign(_cellNum, 0);
+    for (int c = 0; c < _cellNum; ++c) {
+        _partWeight[_part[c]] += _graph.getCellWeight(c);
+        for (const auto &n : _graph.getNetList(c)) {
+            if (_partCount[(size_t)n*_partNum + _part[c]]++ == 0) {
+                ++_spanNum[n];
+            }
+        }
+    }
+    _cutSize = 0;
+    for (int n = 0; n < _netNum; ++n) {
+        if (_spanNum[n] > 1) {
+            _cutSize += _graph.getNetWeight(n);
+        }
+    }
+    _initCutSize = _cutSize;
+    return;
+}
+
+void KWayRefiner::initGains()
+{
+    _lock.assign(_cellNum, 0);
+    for (int c = 0, end = _fixedPart.size(); c < end; ++c) {
+        _lock[c] = (_fixedPart[c] >= 0);
+    }
+    _gain.assign((size_t)_cellNum * _partNum, 0);
+    for (int n = 0; n < _netNum; ++n) {
+        updateNet(n, 1, false);
+    }
+
+    // gain ranges over [-Pmax, +Pmax] => 2*Pmax+1 buckets per destination part
+    _bList.init(_partNum, _cellNum * _partNum, _maxPinNum);
+    for (int c = 0; c < _cellNum; ++c) {
+        for (int p = 0; p < _partNum && !_lock[c]; ++p) {
+            if (p != _part[c]) {
+                addNode(c, p);
+            }
+        }
+    }
+    return;
+}
+
+bool KWayRefiner::selectMove(int& cellId, int& to) const
+{
+    // best gain over all destination parts, ties go to the lower part
+    int bestGain = INT_MIN;
+    for (int p = 0; p < _partNum; ++p) {
+        int scanNum = 0;
+        for (int gain = _bList.getTopGain(p); gain >= -_maxPinNum && gain > bestGain && scanNum < SELECT_SCAN_NUM;
+             gain = _bList.getLowerGain(p, gain)) {
+            int node = _bList.getFirst(p, gain);
+            while (node != NIL_CELL && scanNum < SELECT_SCAN_NUM && !isMovable(node / _partNum, p)) {
+                ++scanNum;
+                node = _bList.getNext(node);
+            }
+            if (node != NIL_CELL && scanNum < SELECT_SCAN_NUM) {
+                bestGain = gain;
+                cellId = node / _partNum;
+                to = p;
+                break;
+            }
+        }
+    }
+    return bestGain != INT_MIN;
+}
+
+void KWayRefiner::moveCell(const int cellId, const int to, const bool update)
+{
+    const int from = _part[cellId];
+    // gains of unlocked cells only change on nets spanning at most 2 parts before or after
+    for (const auto &n : _graph.getNetList(cellId)) {
+        int* count = &_partCount[(size_t)n * _partNum];
+        const int spanNum = _spanNum[n] - (count[from] == 1) + (count[to] == 0);
+        const bool critical = update && _graph.getNetSize(n) > 1 && (_spanNum[n] <= 2 || spanNum <= 2);
+        if (critical) {
+            updateNet(n, -1, true);
+        }
+        --count[from];
+        ++count[to];
+        if (_spanNum[n] == 1 && spanNum > 1) {
+            _cutSize += _graph.getNetWeight(n);
+        }
+        else if (_spanNum[n] > 1 && spanNum == 1) {
+            _cutSize -= _graph.getNetWeight(n);
+        }
+        _spanNum[n] = spanNum;
+        if (critical) {
+            updateNet(n, 1, true);
+        }
+    }
+    const int weight = _graph.getCellWeight(cellId);
+    _partWeight[from] -= weight;
+    _partWeight[to] += weight;
+    _part[cellId] = to;
+    return;
+}
+
+void KWayRefiner::updateNet(const int netId, const int sign, const bool inBucket)
+{
+    // add (sign 1) / remove (sign -1) the gain contribution of a net to its unlocked cells:
+    //   net inside one part: moving any cell out cuts it (-w toward every other part)
+    //   net over two parts:  moving the only cell of one part into the other uncuts it (+w)
+    const IdRange cellList = _graph.getCellList(netId);
+    const int weight = sign * _graph.getNetWeight(netId);
+    const int* count = &_partCount[(size_t)netId * _partNum];
+    const int spanNum = _spanNum[netId];
+    if (cellList.size() < 2 || spanNum > 2) {
+        return;
+    }
+    STATS_COUNT(_stats, COUNT_NET_VISIT, 1);
+    int part[2] = {-1, -1};
+    for (int p = 0, i = 0; p < _partNum && i < spanNum; ++p) {
+        if (count[p] > 0) {
+            part[i++] = p;
+        }
+    }
+    for (const auto &c : cellList) {
+        if (_lock[c]) {
+            continue;
+        }
+        if (spanNum == 1) {
+            for (int p = 0; p < _partNum; ++p) {
+                if (p != part[0]) {
+                    changeGain(c, p, -weight, inBucket);
+                }
+            }
+        }
+        else if (count[_part[c]] == 1) {
+            changeGain(c, (_part[c] == part[0]) ? part[1] : part[0], weight, inBucket);
+        }
+    }
+    return;
+}
+
+void KWayRefiner::changeGain(const int cellId, const int to, const int delta, const bool inBucket)
+{
+    STATS_COUNT(_stats, COUNT_GAIN_UPDATE, 1);
+    if (inBucket) {
+        rmNode(cellId, to);
+    }
+    _gain[(size_t)cellId*_partNum + to] += delta;
+    if (inBucket) {
+        addNode(cellId, to);
+    }
+    return;
+}
+
+void KWayRefiner::addNode(const int cellId, const int to)
+{
+    STATS_COUNT(_stats, COUNT_BUCKET_INSERT, 1);
+    const int node = cellId*_partNum + to;
+    _bList.add(to, node, _gain[node]);
+    return;
+}
+
+void KWayRefiner::rmNode(const int cellId, const int to)
+{
+    STATS_COUNT(_stats, COUNT_BUCKET_REMOVE, 1);
+    const int node = cellId*_partNum + to;
+    _bList.remove(to, node, _gain[node]);
+    return;
+}
@@ -0,0 +1,83 @@
+#ifndef KWAYREFINER_H
+#define KWAYREFINER_H
+
+#include <vector>
+#include "gainbuckets.h"
+#include "hypergraph.h"
+#include "partitionstate.h"
+#include "partitioner.h"
+#include "stats.h"
+using namespace std;
+
+// Direct k-way FM refinement of a k-way partition (cut = weight of the nets
+// spanning more than one part). Every unlocked cell sits in one gain bucket per destination
+// part; a move must keep all parts within (1 +- bFactor) * total / k.
+class KWayRefiner
+{
+public:
+    // Constructor and destructor
+    KWayRefiner(const Hypergraph& graph, const int partNum, const double bFactor);
+    ~KWayRefiner() { }
+
+    // Basic access methods
+    int getCutSize() const                  { return _cutSize; }
+    int getInitCutSize() const              { return _initCutSize; }
+    int getPartNum() const                  { return _partNum; }
+    int getPart(const int c) const          { return _part[c]; }
+    int getPartWeight(const int p) const    { return _partWeight[p]; }
+    int getIterNum() const                  { return _iterNum; }
+    const Stats& getStats() const           { return _stats; }
+    bool isBalanced() const;
+
+    // Modify methods
+    void setPassLimit(const PassLimit& limit)   { _passLimit = limit; }
+    void setMaxIterNum(const int num)           { _maxIterNum = num; }
+    // fixed cells (fixedPart >= 0) never move and stay out of the bucket lists
+    void setFixedParts(const vector<int>& fixedPart)    { _fixedPart = fixedPart; }
+
+    // run FM passes from "part" (values in [0, k)) until a pass gains nothing
+    void refine(const vector<int>& part);
+
+private:
+    const Hypergraph&   _graph;         // partitioned hypergraph
+    int                 _partNum;       // k
+    int                 _cellNum;       // number of cells
+    int                 _netNum;        // number of nets
+    int                 _maxPinNum;     // Pmax for building bucket lists
+    double              _minWeight;     // lower bound of a part weight
+    double              _maxWeight;     // upper bound of a part weight
+    int                 _cutSize;       // weight of the nets spanning more than one part
+    int                 _initCutSize;   // cut size of the given partition
+    int                 _iterNum;       // number of passes
+    int                 _maxIterNum;    // max number of passes (0 = until no gain)
+    PassLimit           _passLimit;     // early exit policy of each pass
+
+    vector<int>             _part;          // part of each cell
+    vector<int>             _partWeight;    // weight of each part
+    vector<int>             _partCount;     // cell number of each net in each part (net*k + part)
+    vector<int>             _spanNum;       // number of parts each net spans
+    vector<unsigned char>   _lock;          // whether each cell is locked
+    vector<int>             _gain;          // gain of each cell toward each part (cell*k + part)
+    GainBuckets             _bList;         // bucket list of each destination part (nodes are cell*k + part)
+    vector<int>             _moveStack;     // history of moved cells
+    vector<int>             _fromStack;     // part each moved cell came from
+    vector<int>             _fixedPart;     // fixed part of each cell (-1 = free, empty = none fixed)
+    Stats                   _stats;         // counters (collected with FM_STATS)
+
+    void init(const vector<int>& part);
+    void initGains();
+    bool selectMove(int& cellId, int& to) const;
+    void moveCell(const int cellId, const int to, const bool update);
+    void updateNet(const int netId, const int sign, const bool inBucket);
+    void changeGain(const int cellId, const int to, const int delta, const bool inBucket);
+    void addNode(const int cellId, const int to);
+    void rmNode(const int cellId, const int to);
+
+    bool isMovable(const int cellId, const int to) const {
+        const int weight = _graph.getCellWeight(cellId);
+        return _partWeight[to] + weight <= _maxWeight
+               && _partWeight[_part[cellId]] - weight >= _minWeight;
+    }
+};
+
+#endif  // KWAYREFINER_H
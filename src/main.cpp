@@ -1,40 +1,189 @@
 #include <iostream>
 #include <fstream>
 #include <vector>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <chrono>
 #include "partitioner.h"
-#include <time.h>
+#include <sys/resource.h>
 
 using namespace std;
 
+static void usage()
+{
+    cerr << "Usage: ./fm [options] <input file> <output file>" << endl
+         << "Options:" << endl
+         << "  --write-cache <file>   save the parsed netlist as a binary cache" << endl
+         << "                         (a cache can be given as <input file> later)" << endl
+         << "  --merge-nets           merge nets with the same cells into one weighted net" << endl
+         << "                         (before --write-cache, which then saves the merged netlist)" << endl
+         << "  --multilevel           coarsen, partition the coarsest level, refine with capped FM passes" << endl
+         << "  --seed <n>             random seed (default 0)" << endl
+         << "  --init <method>        initial solution: order (parse order, default), random," << endl
+         << "                         grow (greedy hypergraph growing), lp (label propagation clusters)" << endl
+         << "  --starts <n>           run n randomized starts and keep the best (default 1)" << endl
+         << "  --threads <n>          threads used by --starts and -k, and to parse large netlists and" << endl
+         << "                         compute their gains (default 1, at most one per core for these two" << endl
+         << "                         unless FM_FORCE_THREADS is set)" << endl
+         << "  --parallel-refine      refine 2-way runs (flat or --multilevel) by label propagation and" << endl
+         << "                         localized FM on --threads threads instead of sequential FM passes" << endl
+         << "  --low-memory           keep no net names, no cell name index and no rollback journal" << endl
+         << "                         (about 8 bytes per pin, 28 per cell plus its name, 16 per net; no --write-cache)" << endl
+         << "  --stall-moves <k>      end an FM pass after k moves without a new best prefix" << endl
+         << "  --move-ratio <f>       end an FM pass after a fraction f of the cells has moved" << endl
+         << "  --skip-net-size <s>    ignore nets with more than s cells in gain updates" << endl
+         << "                         (the final cutsize still counts them)" << endl
+         << "  --fixed <file>         fix cells to parts, one \"<cell> <part>\" pair per cell" << endl
+         << "                         (part 0 = A / G1, 1 = B / G2, ...)" << endl
+         << "  --part-ids <file>      also write the part of every cell, one \"<cell> <part>\" line each" << endl
+         << "                         (binary part ids in cell order if the name ends in .bin)" << endl
+         << "  --report <file>        write timers and counters as JSON (CSV if the name ends in .csv)," << endl
+         << "                         needs a build with make STATS=1" << endl
+         << "  -k <n>                 n-way partition: recursive bisection (--threads, --multilevel)" << endl
+         << "                         refined by k-way FM, written as G1..Gn" << endl;
+    exit(1);
+}
+
 int main(int argc, char** argv)
 {
-    clock_t tStart = clock();
-    fstream input, output;
+    const chrono::steady_clock::time_point wallStart = chrono::steady_clock::now();
+    fstream output;
+    vector<char*> args;
+    const char* cacheFileName = NULL;
+    const char* fixedFileName = NULL;
+    const char* reportFileName = NULL;
+    const char* partFileName = NULL;
+    bool multilevel = false;
+    bool parallelRefine = false;
+    bool lowMemory = false;
+    bool mergeNets = false;
+    unsigned seed = 0;
+    int startNum = 1;
+    int threadNum = 1;
+    PassLimit passLimit;
+    int skipNetSize = 0;
+    int partNum = 2;
+    int initMethod = INIT_ORDER;
 
-    if (argc == 3) {
-        input.open(argv[1], ios::in);
-        output.open(argv[2], ios::out);
-        if (!input) {
-            cerr << "Cannot open the input file \"" << argv[1]
-                 << "\". The program will be terminated..." << endl;
-            exit(1);
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--write-cache") == 0 && i + 1 < argc) {
+            cacheFileName = argv[++i];
+        }
+        else if (strcmp(argv[i], "--fixed") == 0 && i + 1 < argc) {
+            fixedFileName = argv[++i];
+        }
+        else if (strcmp(argv[i], "--part-ids") == 0 && i + 1 < argc) {
+            partFileName = argv[++i];
+        }
+        else if (strcmp(argv[i], "--report") == 0 && i + 1 < argc) {
+            reportFileName = argv[++i];
+        }
+        else if (strcmp(argv[i], "--multilevel") == 0) {
+            multilevel = true;
+        }
+        else if (strcmp(argv[i], "--parallel-refine") == 0) {
+            parallelRefine = true;
+        }
+        else if (strcmp(argv[i], "--merge-nets") == 0) {
+            mergeNets = true;
+        }
+        else if (strcmp(argv[i], "--low-memory") == 0) {
+            lowMemory = true;
+        }
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = strtoul(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "--init") == 0 && i + 1 < argc) {
+            initMethod = InitPartitioner::find(argv[++i]);
+            if (initMethod < 0) {
+                usage();
+            }
+        }
+        else if (strcmp(argv[i], "--starts") == 0 && i + 1 < argc) {
+            startNum = max(1, atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threadNum = max(1, atoi(argv[++i]));
         }
+        else if (strcmp(argv[i], "--stall-moves") == 0 && i + 1 < argc) {
+            passLimit.stallMoveNum = max(0, atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--move-ratio") == 0 && i + 1 < argc) {
+            passLimit.moveRatio = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--skip-net-size") == 0 && i + 1 < argc) {
+            skipNetSize = max(0, atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "-k") == 0 && i + 1 < argc) {
+            partNum = max(2, atoi(argv[++i]));
+        }
+        else if (argv[i][0] == '-' && argv[i][1] == '-') {
+            usage();
+        }
+        else {
+            args.push_back(argv[i]);
+        }
+    }
+
+    if (args.size() == 2) {
+        output.open(args[1], ios::out);
         if (!output) {
-            cerr << "Cannot open the output file \"" << argv[2]
+            cerr << "Cannot open the output file \"" << args[1]
                  << "\". The program will be terminated..." << endl;
             exit(1);
         }
     }
     else {
-        cerr << "Usage: ./fm <input file> <output file>" << endl;
-        exit(1);
+        usage();
     }
 
-    Partitioner* partitioner = new Partitioner(input);
-    partitioner->partition();
+    Partitioner* partitioner = new Partitioner(args[0], threadNum, lowMemory);
+    if (mergeNets) {
+        partitioner->mergeDuplicateNets();
+    }
+    if (cacheFileName != NULL && !partitioner->writeCache(cacheFileName)) {
+        cerr << "Cannot write the cache file \"" << cacheFileName << "\""
+             << (lowMemory ? " (--low-memory keeps no net names)." : ".") << endl;
+    }
+    if (fixedFileName != NULL) {
+        partitioner->readFixed(fixedFileName, partNum);
+    }
+    PartitionConfig config;
+    config.seed = seed;
+    config.partNum = partNum;
+    config.startNum = startNum;
+    config.threadNum = threadNum;
+    config.multilevel = multilevel;
+    config.skipNetSize = skipNetSize;
+    config.passLimit = passLimit;
+    config.initMethod = (InitMethod)initMethod;
+    config.parallelRefine = parallelRefine;
+    partitioner->partition(config);
     partitioner->printSummary();
     partitioner->writeResult(output);
+    if (partFileName != NULL && !partitioner->writePartIds(partFileName)) {
+        cerr << "Cannot write the part id file \"" << partFileName << "\"." << endl;
+    }
 
-    printf("Time taken: %.2fs\n", (double)(clock() - tStart)/CLOCKS_PER_SEC);
+    // wall time: clock() would sum the CPU time of every thread
+    const double wallTime = chrono::duration<double>(chrono::steady_clock::now() - wallStart).count();
+    printf("Time taken: %.2fs\n", wallTime);
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) == 0) {
+        printf("Peak memory: %.1f MB\n", ru.ru_maxrss / 1024.0);
+    }
+    if (reportFileName != NULL) {
+#ifdef FM_STATS
+        Stats& stats = partitioner->getStats();
+        stats.addTime(PHASE_TOTAL, wallTime);
+        if (!stats.write(reportFileName)) {
+            cerr << "Cannot write the report file \"" << reportFileName << "\"." << endl;
+        }
+#else
+        cerr << "No report written: build with make STATS=1 to collect timers and counters." << endl;
+#endif
+    }
+    delete partitioner;
     return 0;
 }
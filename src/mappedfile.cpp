@@ -0,0 +1,57 @@
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "mappedfile.h"
+
+using namespace std;
+
+
+bool MappedFile::open(const char* fileName)
+{
+    close();
+    const int fd = ::open(fileName, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void* const addr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr != MAP_FAILED) {
+            madvise(addr, st.st_size, MADV_SEQUENTIAL);
+            _data = (const char*)addr;
+            _size = st.st_size;
+            _mapped = true;
+            ::close(fd);
+            return true;
+        }
+    }
+
+    // fall back to reading the whole stream
+    char chunk[1 << 16];
+    ssize_t n;
+    while ((n = ::read(fd, chunk, sizeof(chunk))) > 0) {
+        _buffer.insert(_buffer.end(), chunk, chunk + n);
+    }
+    ::close(fd);
+    if (n < 0) {
+        _buffer.clear();
+        return false;
+    }
+    _data = _buffer.data();
+    _size = _buffer.size();
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (_mapped) {
+        munmap((void*)_data, _size);
+    }
+    _buffer.clear();
+    _data = NULL;
+    _size = 0;
+    _mapped = false;
+    return;
+}
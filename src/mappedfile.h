@@ -0,0 +1,36 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <vector>
+using namespace std;
+
+// Read-only view of a whole file. The file is mmap'ed when possible and
+// read into a private buffer otherwise (e.g. pipes).
+class MappedFile
+{
+public:
+    // Constructor and destructor
+    MappedFile() : _data(NULL), _size(0), _mapped(false) { }
+    ~MappedFile() { close(); }
+
+    // Basic access methods
+    const char* data() const    { return _data; }
+    size_t size() const         { return _size; }
+    bool isMapped() const       { return _mapped; }
+
+    // Modify methods
+    bool open(const char* fileName);
+    void close();
+
+private:
+    const char*     _data;      // first byte of the file
+    size_t          _size;      // size of the file in bytes
+    bool            _mapped;    // whether _data is an mmap'ed region
+    vector<char>    _buffer;    // fallback storage when mmap is unavailable
+
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+};
+
+#endif  // MAPPEDFILE_H
@@ -0,0 +1,197 @@
+#include <cstring>
+#include "nametable.h"
+
+using namespace std;
+
+// the direct N -> id array covers N below this, or below 4x the name number
+// (larger N, e.g. a lone c999999999, is hashed instead)
+#define DENSE_MIN_NUM   (1 << 20)
+
+
+uint64_t NameTable::hash(string_view name)
+{
+    // FNV-1a, 8 bytes per round with a final avalanche
+    uint64_t h = 0xcbf29ce484222325ULL;
+    const char* p = name.data();
+    size_t n = name.size();
+    while (n >= 8) {
+        uint64_t w;
+        memcpy(&w, p, 8);
+        h = (h ^ w) * 0x100000001b3ULL;
+        p += 8;
+        n -= 8;
+    }
+    while (n > 0) {
+        h = (h ^ (unsigned char)*p) * 0x100000001b3ULL;
+        ++p;
+        --n;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+}
+
+int NameTable::parseNum(string_view name) const
+{
+    // <prefix><N> with 1..9 digits and no leading zero, else -1
+    const size_t len = name.size();
+    if (_prefix == 0 || len < 2 || len > 10 || name[0] != _prefix) {
+        return -1;
+    }
+    if (name[1] == '0' && len > 2) {
+        return -1;
+    }
+    int num = 0;
+    for (size_t i = 1; i < len; ++i) {
+        const unsigned d = (unsigned char)name[i] - '0';
+        if (d > 9) {
+            return -1;
+        }
+        num = num * 10 + d;
+    }
+    return num;
+}
+
+int NameTable::probe(string_view name, const uint64_t h) const
+{
+    const size_t mask = _slot.size() - 1;
+    size_t i = h & mask;
+    while (_slot[i] != -1 && getName(_slot[i]) != name) {
+        i = (i + 1) & mask;
+    }
+    return (int)i;
+}
+
+size_t NameTable::denseLimit(const int nameNum)
+{
+    return max((size_t)DENSE_MIN_NUM, 4 * (size_t)nameNum);
+}
+
+bool NameTable::isDense(const int id) const
+{
+    const int num = parseNum(getName(id));
+    return num >= 0 && num < (int)_numId.size() && _numId[num] == id;
+}
+
+int NameTable::find(string_view name) const
+{
+    // a <prefix><N> name is in the direct array, or hashed if N was too large
+    const int num = parseNum(name);
+    if (num >= 0 && num < (int)_numId.size() && _numId[num] != -1) {
+        return _numId[num];
+    }
+    if (_slot.empty()) {
+        return -1;
+    }
+    return _slot[probe(name, hash(name))];
+}
+
+int NameTable::intern(string_view name, bool& isNew)
+{
+    const int num = parseNum(name);
+    if (num >= 0) {
+        if (num < (int)_numId.size() && _numId[num] != -1) {
+            isNew = false;
+            return _numId[num];
+        }
+        // (hashed earlier while N was out of the array bound)
+        const int hashedId = _slot.empty() ? -1 : _slot[probe(name, hash(name))];
+        if (hashedId != -1) {
+            isNew = false;
+            return hashedId;
+        }
+        if ((size_t)num < denseLimit(size() + 1)) {
+            if (num >= (int)_numId.size()) {
+                _numId.resize(min(max((size_t)num + 1, 2 * _numId.size()), denseLimit(size() + 1)), -1);
+            }
+            isNew = true;
+            _numId[num] = append(name);
+            return _numId[num];
+        }
+    }
+
+    if (2 * (size() + 1) > (int)_slot.size()) {
+        grow();
+    }
+    int& id = _slot[probe(name, hash(name))];
+    isNew = (id == -1);
+    if (isNew) {
+        id = append(name);
+    }
+    return id;
+}
+
+int NameTable::append(string_view name)
+{
+    _pool.insert(_pool.end(), name.begin(), name.end());
+    _offset.push_back((uint32_t)_pool.size());
+    return size() - 1;
+}
+
+void NameTable::assign(const char* pool, const uint32_t* offset, const int nameNum)
+{
+    clear();
+    _pool.assign(pool, pool + offset[nameNum]);
+    _offset.assign(offset, offset + nameNum + 1);
+    buildIndex();
+}
+
+void NameTable::buildIndex()
+{
+    dropIndex();
+    const int nameNum = size();
+    const size_t limit = denseLimit(nameNum);
+    int hashedNum = 0;
+    for (int id = 0; id < nameNum; ++id) {
+        const int num = parseNum(getName(id));
+        if (num < 0 || (size_t)num >= limit) {
+            ++hashedNum;
+            continue;
+        }
+        if (num >= (int)_numId.size()) {
+            _numId.resize(min(max((size_t)num + 1, 2 * _numId.size()), limit), -1);
+        }
+        _numId[num] = id;
+    }
+    if (hashedNum > 0) {
+        size_t slotNum = 1024;
+        while (slotNum < 2 * (size_t)nameNum) {
+            slotNum *= 2;
+        }
+        _slot.assign(slotNum / 2, -1);
+        grow();
+    }
+}
+
+void NameTable::dropIndex()
+{
+    vector<int>().swap(_slot);
+    vector<int>().swap(_numId);
+}
+
+void NameTable::reserve(const int nameNum, const size_t byteNum)
+{
+    _offset.reserve(nameNum + 1);
+    _pool.reserve(byteNum);
+}
+
+void NameTable::clear()
+{
+    _pool.clear();
+    _offset.assign(1, 0);
+    _slot.clear();
+    _numId.clear();
+}
+
+void NameTable::grow()
+{
+    // rehash every hashed (non fast-path) name into a table twice as large
+    _slot.assign(_slot.empty() ? 1024 : 2 * _slot.size(), -1);
+    for (int id = 0, end = size(); id < end; ++id) {
+        const string_view name = getName(id);
+        if (!isDense(id)) {
+            _slot[probe(name, hash(name))] = id;
+        }
+    }
+}
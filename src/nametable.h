@@ -0,0 +1,54 @@
+#ifndef NAMETABLE_H
+#define NAMETABLE_H
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+using namespace std;
+
+// Dense id <-> name table. All names are stored back to back in one
+// character pool; lookups go through an open-addressing hash of ids.
+// Names of the form <prefix><N> (e.g. c123) bypass hashing and are mapped
+// through a direct N -> id array while N stays within a bound of the name
+// number (see denseLimit()).
+class NameTable
+{
+public:
+    // Constructor and destructor
+    NameTable(const char prefix = 0) : _prefix(prefix), _offset(1, 0) { }
+    ~NameTable() { }
+
+    // Basic access methods
+    int size() const                    { return (int)_offset.size() - 1; }
+    string_view getName(const int id) const {
+        return string_view(_pool.data() + _offset[id], _offset[id+1] - _offset[id]);
+    }
+    int find(string_view name) const;
+    const vector<char>& getPool() const         { return _pool; }
+    const vector<uint32_t>& getOffsets() const  { return _offset; }
+
+    // Modify methods
+    int intern(string_view name, bool& isNew);  // id of "name", added if new
+    int append(string_view name);               // add without indexing (ids only)
+    void assign(const char* pool, const uint32_t* offset, const int nameNum); // reload a saved table
+    void buildIndex();      // (re)build the lookup index of all names
+    void dropIndex();       // free the lookup index (find() fails until buildIndex())
+    void reserve(const int nameNum, const size_t byteNum);
+    void clear();
+
+private:
+    char                _prefix;    // prefix of names taking the numeric fast path
+    vector<char>        _pool;      // concatenated names
+    vector<uint32_t>    _offset;    // name i spans [_offset[i], _offset[i+1]) of _pool
+    vector<int>         _slot;      // hash table of ids (-1 = empty), size is a power of 2
+    vector<int>         _numId;     // <prefix><N> -> id (-1 = unseen)
+
+    static uint64_t hash(string_view name);
+    static size_t denseLimit(const int nameNum);    // bound of N in _numId for nameNum names
+    bool isDense(const int id) const;               // whether id is found through _numId
+    int parseNum(string_view name) const;
+    int probe(string_view name, const uint64_t h) const;
+    void grow();
+};
+
+#endif  // NAMETABLE_H
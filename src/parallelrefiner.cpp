@@ -0,0 +1,377 @@
+#include <algorithm>
+#include <climits>
+#include <iostream>
+#include <queue>
+#include <thread>
+#include "parallelrefiner.h"
+
+using namespace std;
+
+// label propagation sub-round pairs per round
+#define LP_ROUND_NUM        4
+// localized FM: max moves of a search, moves without a new best prefix, largest net followed
+#define LOCAL_MOVE_NUM      256
+#define LOCAL_STALL_NUM     32
+#define LOCAL_NET_SIZE      50
+// owner of the cells moved in a FM round (no search can take them again)
+#define LOCKED_OWNER        INT_MIN
+
+
+ParallelRefiner::ParallelRefiner(const Hypergraph& graph, const double bFactor, const double ratio, const int threadNum) :
+    _graph(graph), _cellNum(graph.getCellNum()), _netNum(graph.getNetNum()), _threadNum(max(1, threadNum)),
+    _cutSize(0), _initCutSize(0), _roundNum(0), _maxRoundNum(0), _lpMoveNum(0), _fmMoveNum(0)
+{
+    // same bounds as Partitioner: A >= ratio*(1-b)*T and B >= (1-ratio)*(1-b)*T
+    const double totalWeight = graph.getTotalWeight();
+    _maxWeight[0] = (long long)(totalWeight - (1-ratio)*(1-bFactor)*totalWeight);
+    _maxWeight[1] = (long long)(totalWeight - ratio*(1-bFactor)*totalWeight);
+}
+
+template <typename F>
+void ParallelRefiner::parallelFor(const int n, F fn) const
+{
+    vector<thread> pool;
+    for (int t = 1; t < _threadNum; ++t) {
+        pool.emplace_back(fn, t, (int)((long long)n * t / _threadNum), (int)((long long)n * (t+1) / _threadNum));
+    }
+    fn(0, 0, n / _threadNum);
+    for (auto &th : pool) {
+        th.join();
+    }
+}
+
+void ParallelRefiner::init(const vector<unsigned char>& assign)
+{
+    _part = vector<atomic<unsigned char> >(_cellNum);
+    _owner = vector<atomic<int> >(_cellNum);
+    _partCount = vector<atomic<int> >(2 * _netNum);
+    parallelFor(_cellNum, [&](const int, const int begin, const int end) {
+        for (int c = begin; c < end; ++c) {
+            _part[c].store(assign[c], memory_order_relaxed);
+            _owner[c].store(-1, memory_order_relaxed);
+        }
+    });
+    parallelFor(_netNum, [&](const int, const int begin, const int end) {
+        for (int n = begin; n < end; ++n) {
+            int countB = 0;
+            for (const auto &c : _graph.getCellList(n)) {
+                countB += assign[c];
+            }
+            _partCount[2*n].store(_graph.getNetSize(n) - countB, memory_order_relaxed);
+            _partCount[2*n + 1].store(countB, memory_order_relaxed);
+        }
+    });
+    long long weight[2] = {0, 0};
+    for (int c = 0; c < _cellNum; ++c) {
+        weight[assign[c]] += _graph.getCellWeight(c);
+    }
+    _partWeight[0].store(weight[0]);
+    _partWeight[1].store(weight[1]);
+    _lpMoveNum = 0;
+    _fmMoveNum = 0;
+}
+
+int ParallelRefiner::countCutSize() const
+{
+    vector<long long> cut(_threadNum, 0);
+    parallelFor(_netNum, [&](const int t, const int begin, const int end) {
+        for (int n = begin; n < end; ++n) {
+            if (_partCount[2*n].load(memory_order_relaxed) > 0 && _partCount[2*n + 1].load(memory_order_relaxed) > 0) {
+                cut[t] += _graph.getNetWeight(n);
+            }
+        }
+    });
+    long long cutSize = 0;
+    for (const auto &c : cut) {
+        cutSize += c;
+    }
+    return (int)cutSize;
+}
+
+int ParallelRefiner::cellGain(const int c) const
+{
+    // counts may be changing under other threads: an estimate, moveCell() credits the exact gain
+    const int from = _part[c].load(memory_order_relaxed);
+    int gain = 0;
+    for (const auto &n : _graph.getNetList(c)) {
+        gain += _graph.getNetWeight(n) * ((_partCount[2*n + from].load(memory_order_relaxed) == 1)
+                                          - (_partCount[2*n + !from].load(memory_order_relaxed) == 0));
+    }
+    return gain;
+}
+
+bool ParallelRefiner::moveCell(const int c, int& gain)
+{
+    const int from = _part[c].load(memory_order_relaxed);
+    const int to = !from;
+    const int weight = _graph.getCellWeight(c);
+    // reserve the weight in the destination first, so concurrent moves never overfill it
+    if (_partWeight[to].fetch_add(weight) + weight > _maxWeight[to]) {
+        _partWeight[to].fetch_sub(weight);
+        return false;
+    }
+    _partWeight[from].fetch_sub(weight);
+    _part[c].store(to, memory_order_relaxed);
+
+    // the count updates that empty a side (uncut) or fill an empty one (cut)
+    // belong to this move, whatever other moves run at the same time
+    gain = 0;
+    for (const auto &n : _graph.getNetList(c)) {
+        const int netWeight = _graph.getNetWeight(n);
+        if (_partCount[2*n + from].fetch_sub(1) == 1) {
+            gain += netWeight;
+        }
+        if (_partCount[2*n + to].fetch_add(1) == 0) {
+            gain -= netWeight;
+        }
+    }
+    return true;
+}
+
+void ParallelRefiner::refine(vector<unsigned char>& assign, const unsigned seed)
+{
+    init(assign);
+    mt19937 rng(seed);
+    _cutSize = countCutSize();
+    _initCutSize = _cutSize;
+    _roundNum = 0;
+    while (1) {
+        ++_roundNum;
+        const int gain = labelPropagation() + localizedFM(rng);
+        _cutSize -= gain;
+        if (gain <= 0 || _roundNum == _maxRoundNum) {
+            break;
+        }
+    }
+#ifdef FM_DEBUG
+    if (_cutSize != countCutSize()) {
+        cerr << "Parallel refinement: credited cutsize " << _cutSize << " != " << countCutSize() << endl;
+    }
+#endif
+    for (int c = 0; c < _cellNum; ++c) {
+        assign[c] = _part[c].load(memory_order_relaxed);
+    }
+    STATS_COUNT(_stats, COUNT_MOVE, _lpMoveNum + _fmMoveNum);
+}
+
+int ParallelRefiner::labelPropagation()
+{
+    int totalGain = 0;
+    vector<vector<pair<int, int> > > candidate(_threadNum);
+    vector<pair<int, int> > merged;
+    vector<int> batch;
+    for (int round = 0; round < LP_ROUND_NUM; ++round) {
+        int roundGain = 0;
+        for (int from = 0; from < 2; ++from) {
+            // positive-gain cells of "from", rated on the state before the batch
+            parallelFor(_cellNum, [&](const int t, const int begin, const int end) {
+                candidate[t].clear();
+                for (int c = begin; c < end; ++c) {
+                    if (_part[c].load(memory_order_relaxed) == from && !isFixed(c)) {
+                        const int gain = cellGain(c);
+                        if (gain > 0) {
+                            candidate[t].push_back(make_pair(-gain, c));
+                        }
+                    }
+                }
+            });
+            merged.clear();
+            for (const auto &list : candidate) {
+                merged.insert(merged.end(), list.begin(), list.end());
+            }
+            // the best ones that fit into the destination (ties by id: thread independent)
+            sort(merged.begin(), merged.end());
+            batch.clear();
+            long long weight = _partWeight[!from].load();
+            for (const auto &item : merged) {
+                const int cellWeight = _graph.getCellWeight(item.second);
+                if (weight + cellWeight <= _maxWeight[!from]) {
+                    weight += cellWeight;
+                    batch.push_back(item.second);
+                }
+            }
+            atomic<int> batchGain(0);
+            parallelFor(batch.size(), [&](const int, const int begin, const int end) {
+                int sum = 0;
+                for (int i = begin; i < end; ++i) {
+                    int gain;
+                    moveCell(batch[i], gain);
+                    sum += gain;
+                }
+                batchGain += sum;
+            });
+            roundGain += batchGain;
+            _lpMoveNum += batch.size();
+        }
+        totalGain += roundGain;
+        if (roundGain <= 0) {
+            break;
+        }
+    }
+    return totalGain;
+}
+
+int ParallelRefiner::localizedFM(mt19937& rng)
+{
+    // seeds: the free cells on a cut net that would not lose moving, in random order
+    vector<vector<int> > boundary(_threadNum);
+    parallelFor(_cellNum, [&](const int t, const int begin, const int end) {
+        boundary[t].clear();
+        for (int c = begin; c < end; ++c) {
+            if (isFixed(c) || cellGain(c) < 0) {
+                continue;
+            }
+            for (const auto &n : _graph.getNetList(c)) {
+                if (_partCount[2*n].load(memory_order_relaxed) > 0 && _partCount[2*n + 1].load(memory_order_relaxed) > 0) {
+                    boundary[t].push_back(c);
+                    break;
+                }
+            }
+        }
+    });
+    vector<int> seeds;
+    for (const auto &list : boundary) {
+        seeds.insert(seeds.end(), list.begin(), list.end());
+    }
+    shuffle(seeds.begin(), seeds.end(), rng);
+
+    // concurrent searches, each from the next seed nobody owns yet
+    atomic<int> nextSeed(0);
+    atomic<int> totalGain(0);
+    vector<vector<int> > kept(_threadNum);
+    auto worker = [&](const int t) {
+        vector<int> moved, claimed;
+        int gainSum = 0;
+        kept[t].clear();
+        for (int i = nextSeed++; i < (int)seeds.size(); i = nextSeed++) {
+            gainSum += localSearch(seeds[i], i, moved, claimed);
+            kept[t].insert(kept[t].end(), moved.begin(), moved.end());
+        }
+        totalGain += gainSum;
+    };
+    vector<thread> pool;
+    for (int t = 1; t < _threadNum; ++t) {
+        pool.emplace_back(worker, t);
+    }
+    worker(0);
+    for (auto &th : pool) {
+        th.join();
+    }
+
+    vector<int> movedCells;
+    for (const auto &list : kept) {
+        movedCells.insert(movedCells.end(), list.begin(), list.end());
+    }
+    // searches disturbing each other made the round lose: undo its moves
+    // (a move whose way back no longer fits the balance stays)
+    if (totalGain < 0) {
+        atomic<int> stayNum(0);
+        parallelFor(movedCells.size(), [&](const int, const int begin, const int end) {
+            int sum = 0;
+            for (int i = begin; i < end; ++i) {
+                int gain;
+                if (moveCell(movedCells[i], gain)) {
+                    sum += gain;
+                }
+                else {
+                    ++stayNum;
+                }
+            }
+            totalGain += sum;
+        });
+        _fmMoveNum += stayNum;
+    }
+    else {
+        _fmMoveNum += movedCells.size();
+    }
+    parallelFor(_cellNum, [&](const int, const int begin, const int end) {
+        for (int c = begin; c < end; ++c) {
+            _owner[c].store(-1, memory_order_relaxed);
+        }
+    });
+    return totalGain;
+}
+
+int ParallelRefiner::localSearch(const int seed, const int searchId, vector<int>& moved, vector<int>& claimed)
+{
+    moved.clear();
+    claimed.clear();
+    int expected = -1;
+    if (isFixed(seed) || !_owner[seed].compare_exchange_strong(expected, searchId)) {
+        return 0;
+    }
+    claimed.push_back(seed);
+
+    // FM on the owned cells: max gain first, gains re-read when popped (lazy heap)
+    priority_queue<pair<int, int> > heap;
+    heap.push(make_pair(cellGain(seed), seed));
+    int accGain = 0, bestGain = 0, bestNum = 0;
+    while (!heap.empty() && (int)moved.size() < LOCAL_MOVE_NUM && (int)moved.size() - bestNum < LOCAL_STALL_NUM) {
+        const pair<int, int> top = heap.top();
+        heap.pop();
+        const int c = top.second;
+        if (_owner[c].load(memory_order_relaxed) != searchId) {
+            continue;   // moved already
+        }
+        const int current = cellGain(c);
+        if (current < top.first) {
+            heap.push(make_pair(current, c));
+            continue;
+        }
+        int gain;
+        if (!moveCell(c, gain)) {
+            continue;
+        }
+        _owner[c].store(LOCKED_OWNER, memory_order_relaxed);
+        moved.push_back(c);
+        accGain += gain;
+        if (accGain > bestGain) {
+            bestGain = accGain;
+            bestNum = moved.size();
+        }
+        // neighbors on the critical nets (the ones whose gains changed):
+        // new gains of the owned ones, claim the free ones
+        const int to = _part[c].load(memory_order_relaxed);
+        for (const auto &n : _graph.getNetList(c)) {
+            if (_graph.getNetSize(n) > LOCAL_NET_SIZE
+                || (_partCount[2*n + !to].load(memory_order_relaxed) > 1 && _partCount[2*n + to].load(memory_order_relaxed) > 2)) {
+                continue;
+            }
+            for (const auto &v : _graph.getCellList(n)) {
+                if (isFixed(v)) {
+                    continue;
+                }
+                int owner = _owner[v].load(memory_order_relaxed);
+                if (owner == -1 && _owner[v].compare_exchange_strong(owner, searchId)) {
+                    claimed.push_back(v);
+                    owner = searchId;
+                }
+                if (owner == searchId) {
+                    heap.push(make_pair(cellGain(v), v));
+                }
+            }
+        }
+    }
+
+    // back to the best prefix (a move whose way back no longer fits the
+    // balance stays), release the cells that did not move
+    vector<int> stay;
+    for (int i = (int)moved.size() - 1; i >= bestNum; --i) {
+        int gain;
+        if (moveCell(moved[i], gain)) {
+            accGain += gain;
+            _owner[moved[i]].store(searchId, memory_order_relaxed);
+        }
+        else {
+            stay.push_back(moved[i]);
+        }
+    }
+    moved.resize(bestNum);
+    moved.insert(moved.end(), stay.begin(), stay.end());
+    for (const auto &c : claimed) {
+        if (_owner[c].load(memory_order_relaxed) == searchId) {
+            _owner[c].store(-1, memory_order_relaxed);
+        }
+    }
+    return accGain;
+}
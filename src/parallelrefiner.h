@@ -0,0 +1,78 @@
+#ifndef PARALLELREFINER_H
+#define PARALLELREFINER_H
+
+#include <atomic>
+#include <random>
+#include <vector>
+#include "hypergraph.h"
+#include "stats.h"
+using namespace std;
+
+// Multi-threaded refinement of a 2-way partition. Each round runs
+//  - label propagation: synchronous sub-rounds, one direction each, that move
+//    every positive-gain cell of the direction (a one-direction batch gains at
+//    least the sum of its gains, so the batches never conflict)
+//  - localized FM: concurrent FM searches grown from boundary seed cells, each
+//    owning the cells it touches, rolled back to their best prefix
+// on shared state with atomic net counts. Each move is credited with the cut
+// change of its own count updates, so the gains of concurrent moves add up to
+// the exact cut change.
+class ParallelRefiner
+{
+public:
+    // Constructor and destructor (A takes the share "ratio" of the total weight,
+    // within the balance factor "bFactor" as in Partitioner)
+    ParallelRefiner(const Hypergraph& graph, const double bFactor, const double ratio, const int threadNum);
+    ~ParallelRefiner() { }
+
+    // Basic access methods
+    int getCutSize() const                  { return _cutSize; }
+    int getInitCutSize() const              { return _initCutSize; }
+    int getRoundNum() const                 { return _roundNum; }
+    long long getLPMoveNum() const          { return _lpMoveNum; }
+    long long getFMMoveNum() const          { return _fmMoveNum; }
+    const Stats& getStats() const           { return _stats; }
+
+    // Modify methods
+    void setMaxRoundNum(const int num)      { _maxRoundNum = num; }
+    // fixed cells (fixedPart >= 0) never move
+    void setFixedParts(const vector<int>& fixedPart)    { _fixedPart = fixedPart; }
+
+    // refine "assign" (0 = A, 1 = B) in place until a round gains nothing
+    void refine(vector<unsigned char>& assign, const unsigned seed = 0);
+
+private:
+    const Hypergraph&   _graph;         // partitioned hypergraph
+    int                 _cellNum;       // number of cells
+    int                 _netNum;        // number of nets
+    int                 _threadNum;     // worker threads
+    long long           _maxWeight[2];  // upper bound of the weight of A(0) and B(1)
+    int                 _cutSize;       // cut size
+    int                 _initCutSize;   // cut size of the given partition
+    int                 _roundNum;      // number of rounds
+    int                 _maxRoundNum;   // max number of rounds (0 = until no gain)
+    long long           _lpMoveNum;     // moves kept by label propagation
+    long long           _fmMoveNum;     // moves kept by localized FM
+
+    vector<atomic<unsigned char> >  _part;          // part of each cell (written by its owner only)
+    vector<atomic<int> >            _partCount;     // cell number of each net in A(2n) and B(2n+1)
+    vector<atomic<int> >            _owner;         // search owning each cell in a FM round (-1 = free)
+    atomic<long long>               _partWeight[2]; // weight of A(0) and B(1)
+    vector<int>                     _fixedPart;     // fixed part of each cell (-1 = free, empty = none fixed)
+    Stats                           _stats;         // counters (collected with FM_STATS)
+
+    bool isFixed(const int c) const     { return !_fixedPart.empty() && _fixedPart[c] >= 0; }
+
+    void init(const vector<unsigned char>& assign);
+    int countCutSize() const;
+    int cellGain(const int c) const;
+    // move c to the other part if the balance allows it; gain = its share of the cut change
+    bool moveCell(const int c, int& gain);
+    int labelPropagation();
+    int localizedFM(mt19937& rng);
+    int localSearch(const int seed, const int searchId, vector<int>& moved, vector<int>& claimed);
+    // run fn(thread, begin, end) over [0, n) split into _threadNum ranges
+    template <typename F> void parallelFor(const int n, F fn) const;
+};
+
+#endif  // PARALLELREFINER_H
@@ -1,71 +1,730 @@
 #include <iostream>
 #include <iomanip>
 #include <fstream>
-#include <sstream>
 #include <cassert>
 #include <vector>
 #include <cmath>
-#include <map>
 #include <climits>       // added 
-#include "cell.h"
-#include "net.h"
+#include <chrono>
+#include <cstring>
+#include <cstdint>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <charconv>
+#include <mutex>
+#include "mappedfile.h"
+#include "coarsener.h"
+#include "kwayrefiner.h"
+#include "parallelrefiner.h"
 #include "partitioner.h"
 
 using namespace std;
 
+// guards merging the statistics of runs on other threads
+STATS_RUN(static mutex statsMutex;)
 
-void Partitioner::parseInput(fstream& inFile)
+// inputs at least this large are parsed by _threadNum threads
+#define PARALLEL_PARSE_SIZE (4 << 20)
+// gains of at least this many cells are computed by _threadNum threads
+#define PARALLEL_GAIN_CELL_NUM 100000
+// largest weight of a CELL / NET statement
+#define MAX_WEIGHT          1000000
+
+// threads of a parallel sweep: at most one per core (extra ones only add overhead),
+// unless FM_FORCE_THREADS is set, to run the parallel paths on a small machine
+static int sweepThreadNum(const int threadNum)
 {
-    string str;
-    // Set balance factor
-    inFile >> str;
-    _bFactor = stod(str);
+    static const bool force = (getenv("FM_FORCE_THREADS") != NULL);
+    const int coreNum = thread::hardware_concurrency();
+    return (force || coreNum <= 0) ? threadNum : min(threadNum, coreNum);
+}
 
-    // Set up whole circuit
-    while (inFile >> str) {
-        if (str == "NET") {
-            string netName, cellName, tmpCellName = "";
-            inFile >> netName;
-            int netId = _netNum;
-            // cout << netName << " " << _netNum << endl;
-            _netArray.push_back(new Net(netName));
-            _netName2Id[netName] = netId;
-            while (inFile >> cellName) {
-                if (cellName == ";") {
-                    tmpCellName = "";
+// multilevel: stop coarsening at this many cells / levels
+#define COARSEST_CELL_NUM   200
+#define MAX_LEVEL_NUM       32
+// multilevel: number of random starts on the coarsest level
+#define INIT_PART_TRY_NUM   8
+// multilevel: max FM passes on each level, including the finest one
+#define REFINE_ITER_NUM     4
+// multilevel: unless --stall-moves is given, end a refinement pass after this many
+// moves without a new best prefix (a projected cut is already good: gains come early)
+#define REFINE_STALL_NUM    500
+// k-way: max FM passes of each recursive bisection (the k-way FM refines afterwards)
+#define BISECT_ITER_NUM     16
+
+
+// header of the binary netlist cache, followed by the sections
+//   netCells offset[netNum+1], pin[pinNum], cellNets offset[cellNum+1], pin[pinNum],
+//   cell name offset[cellNum+1], pool[cellNameBytes], net name offset[netNum+1], pool[netNameBytes],
+//   cell weight[cellNum] (if CACHE_CELL_WEIGHT), net weight[netNum] (if CACHE_NET_WEIGHT)
+//   each section zero padded to a multiple of CACHE_ALIGN bytes
+struct CacheHeader
+{
+    char        magic[8];       // CACHE_MAGIC
+    uint32_t    version;        // CACHE_VERSION
+    uint32_t    headerSize;     // sizeof(CacheHeader)
+    uint64_t    payloadSize;    // bytes following the header
+    uint64_t    checksum;       // checksum of the payload
+    double      bFactor;        // balance factor
+    int32_t     cellNum;        // number of cells
+    int32_t     netNum;         // number of nets
+    int32_t     pinNum;         // number of pins
+    uint32_t    cellNameBytes;  // size of the cell name pool
+    uint32_t    netNameBytes;   // size of the net name pool
+    uint32_t    flags;          // CACHE_CELL_WEIGHT | CACHE_NET_WEIGHT
+};
+
+static const char CACHE_MAGIC[8] = {'F', 'M', 'C', 'A', 'C', 'H', 'E', '\0'};
+// binary part id file written by writePartIds()
+static const char PART_MAGIC[8] = {'F', 'M', 'P', 'A', 'R', 'T', 'S', '\0'};
+static const uint32_t CACHE_VERSION = 3;
+static const uint32_t CACHE_CELL_WEIGHT = 1;
+static const uint32_t CACHE_NET_WEIGHT = 2;
+// every payload section starts at a multiple of this (zero padded), so the
+// int / uint32 sections can be read in place
+static const size_t CACHE_ALIGN = 8;
+
+static size_t padSize(const size_t n)
+{
+    return (CACHE_ALIGN - n % CACHE_ALIGN) % CACHE_ALIGN;
+}
+
+// offsets of rowNum rows: start at 0, never decrease, end at "total"
+template<class T>
+static bool validOffsets(const T* offset, const int rowNum, const uint64_t total)
+{
+    if (offset[0] != 0 || (uint64_t)offset[rowNum] != total) {
+        return false;
+    }
+    for (int r = 0; r < rowNum; ++r) {
+        if (offset[r+1] < offset[r]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// every id in [0, idNum)
+static bool validIds(const int* id, const int n, const int idNum)
+{
+    for (int i = 0; i < n; ++i) {
+        if (id[i] < 0 || id[i] >= idNum) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static uint64_t checksum(const char* data, size_t n)
+{
+    uint64_t h = 0xcbf29ce484222325ULL;
+    while (n >= 8) {
+        uint64_t w;
+        memcpy(&w, data, 8);
+        h = (h ^ w) * 0x100000001b3ULL;
+        data += 8;
+        n -= 8;
+    }
+    while (n > 0) {
+        h = (h ^ (unsigned char)*data) * 0x100000001b3ULL;
+        ++data;
+        --n;
+    }
+    return h;
+}
+
+// next whitespace separated token of [pos, end), empty at end of input
+static string_view nextToken(const char*& pos, const char* const end)
+{
+    while (pos < end && (unsigned char)*pos <= ' ') {
+        ++pos;
+    }
+    const char* const begin = pos;
+    while (pos < end && (unsigned char)*pos > ' ') {
+        ++pos;
+    }
+    return string_view(begin, pos - begin);
+}
+
+void Partitioner::parseInput(const char* inFileName)
+{
+    const chrono::steady_clock::time_point tStart = chrono::steady_clock::now();
+    MappedFile inFile;
+    if (!inFile.open(inFileName)) {
+        cerr << "Cannot open the input file \"" << inFileName
+             << "\". The program will be terminated..." << endl;
+        exit(1);
+    }
+
+    // a binary cache written by writeCache() skips text parsing entirely
+    const bool isCache = inFile.size() >= sizeof(CacheHeader)
+                      && memcmp(inFile.data(), CACHE_MAGIC, sizeof(CACHE_MAGIC)) == 0;
+    const double sizeMB = inFile.size() / 1048576.0;
+    if (isCache) {
+        loadCache(inFile.data(), inFile.size());
+    }
+    else {
+        parseNetlist(inFile);
+    }
+    // low-memory mode: names are only needed to write the cells out
+    if (_lowMemory) {
+        _cellNames.dropIndex();
+        _netNames.clear();
+    }
+    initGraph();
+
+    const double parseTime = chrono::duration<double>(chrono::steady_clock::now() - tStart).count();
+    STATS_RUN(_stats.addTime(PHASE_PARSE, parseTime);)
+    cout << (isCache ? "Loaded cache " : "Parsed ") << fixed << setprecision(2) << sizeMB << " MB in "
+         << parseTime << "s (" << (parseTime > 0 ? sizeMB / parseTime : 0) << " MB/s)" << defaultfloat << endl;
+    return;
+}
+
+int Partitioner::mergeDuplicateNets()
+{
+    // a shared hypergraph is read-only
+    if (_graph != &_netlist) {
+        return 0;
+    }
+    STATS_TIMER(_stats, PHASE_MERGE);
+    const chrono::steady_clock::time_point tStart = chrono::steady_clock::now();
+    const CSRList& netCells = _netlist.getNetCells();
+    const vector<int>& offset = netCells.getOffsets();
+
+    // sorted cell list of every net, hashed (FNV-1a over the ids); nets with the
+    // same hash are compared in id order, so a net merges into its first twin
+    vector<int> sorted(netCells.getPins());
+    vector<pair<uint64_t, int> > key(_netNum);
+    for (int n = 0; n < _netNum; ++n) {
+        sort(sorted.begin() + offset[n], sorted.begin() + offset[n+1]);
+        uint64_t h = 0xcbf29ce484222325ULL ^ (uint64_t)(offset[n+1] - offset[n]);
+        for (int k = offset[n]; k < offset[n+1]; ++k) {
+            h = (h ^ (uint32_t)sorted[k]) * 0x100000001b3ULL;
+        }
+        key[n] = make_pair(h, n);
+    }
+    sort(key.begin(), key.end());
+    auto sameCells = [&](const int a, const int b) {
+        return offset[a+1] - offset[a] == offset[b+1] - offset[b]
+            && equal(sorted.begin() + offset[a], sorted.begin() + offset[a+1], sorted.begin() + offset[b]);
+    };
+    vector<int> rep(_netNum);
+    vector<int> twins;
+    int mergedNum = 0;
+    for (size_t i = 0, j = 0; i < key.size(); i = j) {
+        // [i, j): one hash value (several distinct lists on a collision)
+        twins.clear();
+        for (j = i; j < key.size() && key[j].first == key[i].first; ++j) {
+            const int n = key[j].second;
+            rep[n] = n;
+            for (const auto &t : twins) {
+                if (sameCells(t, n)) {
+                    rep[n] = t;
+                    ++mergedNum;
                     break;
                 }
-                else {
-                    // a newly seen cell
-                    if (_cellName2Id.count(cellName) == 0) {
-                        int cellId = _cellNum;
-                        _cellArray.push_back(new Cell(cellName, 0, cellId));
-                        _cellName2Id[cellName] = cellId;
-                        _cellArray[cellId]->addNet(netId);
-                        _cellArray[cellId]->incPinNum();
-                        _netArray[netId]->addCell(cellId);
-                        ++_cellNum;
-                        tmpCellName = cellName;
-                    }
-                    // an existed cell
-                    else {
-                        if (cellName != tmpCellName) {
-                            assert(_cellName2Id.count(cellName) == 1);
-                            int cellId = _cellName2Id[cellName];
-                            _cellArray[cellId]->addNet(netId);
-                            _cellArray[cellId]->incPinNum();
-                            _netArray[netId]->addCell(cellId);
-                            tmpCellName = cellName;
-                        }
-                    }
+            }
+            if (rep[n] == n) {
+                twins.push_back(n);
+            }
+        }
+    }
+    if (mergedNum == 0) {
+        return 0;
+    }
+
+    // rebuild the nets in id order with the cell order of the input
+    vector<int> newOffset(1, 0), newPin, newWeight, newId(_netNum);
+    newOffset.reserve(_netNum - mergedNum + 1);
+    newPin.reserve(netCells.getPinNum());
+    newWeight.reserve(_netNum - mergedNum);
+    NameTable netNames('n');
+    const bool named = (_netNames.size() == _netNum);
+    for (int n = 0; n < _netNum; ++n) {
+        if (rep[n] != n) {
+            newWeight[newId[rep[n]]] += _graph->getNetWeight(n);
+            continue;
+        }
+        newId[n] = newWeight.size();
+        newWeight.push_back(_graph->getNetWeight(n));
+        const IdRange cellList = netCells[n];
+        newPin.insert(newPin.end(), cellList.begin(), cellList.end());
+        newOffset.push_back(newPin.size());
+        if (named) {
+            netNames.append(_netNames.getName(n));
+        }
+    }
+    const int removedPinNum = netCells.getPinNum() - (int)newPin.size();
+    vector<int>().swap(sorted);
+    _netlist.getNetCells().assign(std::move(newOffset), std::move(newPin));
+    _netlist.finalize(_cellNum);
+    _netlist.setNetWeights(newWeight);
+    if (named) {
+        _netNames = std::move(netNames);
+    }
+    initGraph();
+
+    STATS_COUNT(_stats, COUNT_MERGED_PIN, removedPinNum);
+    if (_verbose) {
+        cout << "Merged " << mergedNum << " duplicate nets (" << removedPinNum << " pins removed) in "
+             << fixed << setprecision(2) << chrono::duration<double>(chrono::steady_clock::now() - tStart).count()
+             << "s" << defaultfloat << endl;
+    }
+    return mergedNum;
+}
+
+void Partitioner::readFixed(const char* fixedFileName, const int partNum)
+{
+    // "<cell> <part>" pairs, part in [0, partNum) (0 = A / G1, 1 = B / G2, ...)
+    MappedFile fixedFile;
+    if (!fixedFile.open(fixedFileName)) {
+        cerr << "Cannot open the fixed cell file \"" << fixedFileName
+             << "\". The program will be terminated..." << endl;
+        exit(1);
+    }
+    if (_lowMemory) {
+        _cellNames.buildIndex();
+    }
+    _fixedPart.assign(_cellNum, -1);
+    const char* pos = fixedFile.data();
+    const char* const end = pos + fixedFile.size();
+    string_view name;
+    int fixedNum = 0;
+    while (!(name = nextToken(pos, end)).empty()) {
+        const string_view partStr = nextToken(pos, end);
+        const int cellId = _cellNames.find(name);
+        int part = -1;
+        from_chars(partStr.data(), partStr.data() + partStr.size(), part);
+        if (cellId < 0 || part < 0 || part >= partNum) {
+            cerr << "Invalid fixed cell \"" << name << " " << partStr
+                 << "\". The program will be terminated..." << endl;
+            exit(1);
+        }
+        fixedNum += (_fixedPart[cellId] < 0);
+        _fixedPart[cellId] = part;
+    }
+    if (_lowMemory) {
+        _cellNames.dropIndex();
+    }
+    if (_verbose) {
+        cout << "Fixed " << fixedNum << " cells" << endl;
+    }
+    return;
+}
+
+// integer weight in [1, MAX_WEIGHT] of a CELL / NET statement
+static int parseWeight(string_view str)
+{
+    int weight = 0;
+    const from_chars_result result = from_chars(str.data(), str.data() + str.size(), weight);
+    if (result.ec != errc() || result.ptr != str.data() + str.size() || weight <= 0 || weight > MAX_WEIGHT) {
+        cerr << "Invalid weight \"" << str << "\" (1 to " << MAX_WEIGHT
+             << "). The program will be terminated..." << endl;
+        exit(1);
+    }
+    return weight;
+}
+
+// statements of a slice of a text netlist; cell ids are local to the slice
+// (in order of first appearance), so that slices can be parsed concurrently
+struct NetlistChunk
+{
+    NameTable       cellNames;      // cells of the slice
+    NameTable       netNames;       // nets of the slice
+    CSRList         netCells;       // local cell ids of each net
+    vector<int>     netWeight;      // weight of each net
+    vector<int>     cellWeight;     // weight given by CELL statements (0 = none)
+    bool            netWeighted;    // some net weight is not 1
+    bool            keepNetNames;   // whether netNames is filled
+
+    NetlistChunk() : cellNames('c'), netNames('n'), netWeighted(false), keepNetNames(true) { }
+};
+
+// start of the first NET statement (a line beginning with "NET") at or after "pos"
+static const char* nextNetStatement(const char* pos, const char* const begin, const char* const end)
+{
+    for (; (pos = (const char*)memchr(pos, 'N', end - pos)) != NULL; ++pos) {
+        if (pos > begin && pos[-1] == '\n' && end - pos > 3 && memcmp(pos, "NET", 3) == 0
+            && (unsigned char)pos[3] <= ' ') {
+            return pos;
+        }
+    }
+    return end;
+}
+
+static void parseChunk(const char* pos, const char* const end, NetlistChunk& chunk)
+{
+    // size the net storage once: a net per ';', at most a pin per 3 bytes
+    // ("c1 "), so parsing fills preallocated blocks instead of regrowing them
+    int netEstimate = 0;
+    for (const char* p = pos; (p = (const char*)memchr(p, ';', end - p)) != NULL; ++p) {
+        ++netEstimate;
+    }
+    chunk.netCells.reserve(netEstimate, (end - pos) / 3);
+    if (chunk.keepNetNames) {
+        chunk.netNames.reserve(netEstimate, (size_t)netEstimate * 8);
+    }
+    chunk.netWeight.reserve(netEstimate);
+
+    //   NET <net> [WEIGHT <w>] <cell> ... ;    CELL <cell> <w>
+    string_view str;
+    while (!(str = nextToken(pos, end)).empty()) {
+        if (str == "NET") {
+            const string_view netName = nextToken(pos, end);
+            if (chunk.keepNetNames) {
+                chunk.netNames.append(netName);
+            }
+            str = nextToken(pos, end);
+            int weight = 1;
+            if (str == "WEIGHT") {
+                weight = parseWeight(nextToken(pos, end));
+                str = nextToken(pos, end);
+            }
+            chunk.netWeight.push_back(weight);
+            chunk.netWeighted |= (weight != 1);
+            int lastCellId = -1;
+            for (; !str.empty() && str != ";"; str = nextToken(pos, end)) {
+                bool isNew;
+                const int cellId = chunk.cellNames.intern(str, isNew);
+                // skip a cell listed twice in a row
+                if (cellId != lastCellId) {
+                    chunk.netCells.addPin(cellId);
+                    lastCellId = cellId;
                 }
             }
-            ++_netNum;
+            chunk.netCells.closeRow();
+        }
+        else if (str == "CELL") {
+            bool isNew;
+            const int cellId = chunk.cellNames.intern(nextToken(pos, end), isNew);
+            if (cellId >= (int)chunk.cellWeight.size()) {
+                chunk.cellWeight.resize(max(cellId + 1, 2 * (int)chunk.cellWeight.size()), 0);
+            }
+            chunk.cellWeight[cellId] = parseWeight(nextToken(pos, end));
+        }
+    }
+}
+
+void Partitioner::parseNetlist(MappedFile& inFile)
+{
+    const char* const data = inFile.data();
+    const size_t size = inFile.size();
+    const char* pos = data;
+    const char* const dataEnd = data + size;
+
+    // Set balance factor
+    const string_view bFactor = nextToken(pos, dataEnd);
+    _bFactor = stod(string(bFactor));
+    _netBFactor = _bFactor;
+
+    // large inputs are split at NET statements and the slices parsed concurrently
+    const int chunkNum = (size >= PARALLEL_PARSE_SIZE) ? sweepThreadNum(_threadNum) : 1;
+    vector<const char*> bound(chunkNum + 1, dataEnd);
+    bound[0] = pos;
+    for (int k = 1; k < chunkNum; ++k) {
+        bound[k] = nextNetStatement(max(bound[k-1], pos + (dataEnd - pos) * k / chunkNum), data, dataEnd);
+    }
+    vector<NetlistChunk> chunks(chunkNum);
+    for (auto &chunk : chunks) {
+        chunk.keepNetNames = !_lowMemory;
+    }
+    {
+        vector<thread> pool;
+        for (int k = 1; k < chunkNum; ++k) {
+            pool.emplace_back(parseChunk, bound[k], bound[k+1], ref(chunks[k]));
+        }
+        parseChunk(bound[0], bound[1], chunks[0]);
+        for (auto &th : pool) {
+            th.join();
         }
     }
+    // the slices hold copies of the names: drop the file pages before the
+    // adjacency doubles in the transposition
+    inFile.close();
+
+    // merge in file order: a cell takes the id of its first appearance, as in
+    // a serial parse, so the cells new to slice k follow those of slices < k
+    // in local id order
+    vector<int> cellWeight, netWeight;
+    bool netWeighted = false;
+    if (chunkNum == 1) {
+        NetlistChunk& chunk = chunks[0];
+        _cellNames = std::move(chunk.cellNames);
+        _netNames = std::move(chunk.netNames);
+        _netlist.getNetCells() = std::move(chunk.netCells);
+        netWeight.swap(chunk.netWeight);
+        cellWeight.swap(chunk.cellWeight);
+        netWeighted = chunk.netWeighted;
+    }
+    else {
+        // owner of each local cell: the first slice naming it (looked up in the
+        // tables of the earlier slices, concurrently), and its rank among the
+        // cells new to that slice (-1 = named by an earlier slice)
+        vector<vector<int> > globalId(chunkNum), ownerChunk(chunkNum), newRank(chunkNum);
+        vector<int> newNum(chunkNum, 0);
+        auto findOwners = [&](const int k) {
+            const NameTable& names = chunks[k].cellNames;
+            globalId[k].resize(names.size());
+            ownerChunk[k].resize(names.size());
+            newRank[k].assign(names.size(), -1);
+            for (int l = 0, end = names.size(); l < end; ++l) {
+                const string_view name = names.getName(l);
+                int j = 0, ownerId = -1;
+                for (; j < k && (ownerId = chunks[j].cellNames.find(name)) < 0; ++j) { }
+                ownerChunk[k][l] = j;
+                globalId[k][l] = (j < k) ? ownerId : l;
+                if (j == k) {
+                    newRank[k][l] = newNum[k]++;
+                }
+            }
+        };
+        {
+            vector<thread> pool;
+            for (int k = 1; k < chunkNum; ++k) {
+                pool.emplace_back(findOwners, k);
+            }
+            findOwners(0);
+            for (auto &th : pool) {
+                th.join();
+            }
+        }
+        // the global tables: copy the new names of each slice in order
+        vector<int> cellBase(chunkNum + 1, 0), netBase(chunkNum + 1, 0), pinBase(chunkNum + 1, 0);
+        size_t cellBytes = 0, netBytes = 0;
+        for (int k = 0; k < chunkNum; ++k) {
+            cellBase[k+1] = cellBase[k] + newNum[k];
+            netBase[k+1] = netBase[k] + chunks[k].netCells.getRowNum();
+            pinBase[k+1] = pinBase[k] + chunks[k].netCells.getPinNum();
+            cellBytes += chunks[k].cellNames.getPool().size();
+            netBytes += chunks[k].netNames.getPool().size();
+        }
+        _cellNames.reserve(cellBase[chunkNum], cellBytes);
+        if (!_lowMemory) {
+            _netNames.reserve(netBase[chunkNum], netBytes);
+        }
+        for (int k = 0; k < chunkNum; ++k) {
+            NetlistChunk& chunk = chunks[k];
+            for (int l = 0, end = chunk.cellNames.size(); l < end; ++l) {
+                if (newRank[k][l] >= 0) {
+                    _cellNames.append(chunk.cellNames.getName(l));
+                }
+            }
+            for (int n = 0, end = chunk.netNames.size(); n < end; ++n) {
+                _netNames.append(chunk.netNames.getName(n));
+            }
+            netWeight.insert(netWeight.end(), chunk.netWeight.begin(), chunk.netWeight.end());
+            netWeighted |= chunk.netWeighted;
+        }
+        // low-memory mode drops the index after parsing anyway
+        if (!_lowMemory) {
+            _cellNames.buildIndex();
+        }
+
+        // global ids and pins of each slice, concurrently
+        vector<int> offset(netBase[chunkNum] + 1, pinBase[chunkNum]);
+        vector<int> pin(pinBase[chunkNum]);
+        auto relabel = [&](const int k) {
+            vector<int>& ids = globalId[k];
+            for (int l = 0, end = ids.size(); l < end; ++l) {
+                const int j = ownerChunk[k][l];
+                ids[l] = cellBase[j] + newRank[j][ids[l]];
+            }
+            const vector<int>& localOffset = chunks[k].netCells.getOffsets();
+            const vector<int>& localPin = chunks[k].netCells.getPins();
+            for (int n = 0, end = chunks[k].netCells.getRowNum(); n < end; ++n) {
+                offset[netBase[k] + n] = pinBase[k] + localOffset[n];
+            }
+            for (int i = 0, end = localPin.size(); i < end; ++i) {
+                pin[pinBase[k] + i] = ids[localPin[i]];
+            }
+        };
+        {
+            vector<thread> pool;
+            for (int k = 1; k < chunkNum; ++k) {
+                pool.emplace_back(relabel, k);
+            }
+            relabel(0);
+            for (auto &th : pool) {
+                th.join();
+            }
+        }
+        // CELL statements, in file order
+        for (int k = 0; k < chunkNum; ++k) {
+            const vector<int>& weight = chunks[k].cellWeight;
+            if (!weight.empty() && cellWeight.empty()) {
+                cellWeight.assign(cellBase[chunkNum], 0);
+            }
+            for (int l = 0, end = weight.size(); l < end; ++l) {
+                if (weight[l] > 0) {
+                    cellWeight[globalId[k][l]] = weight[l];
+                }
+            }
+        }
+        _netlist.getNetCells().assign(std::move(offset), std::move(pin));
+    }
+    _cellNum = _cellNames.size();
+    _netNum = _netlist.getNetCells().getRowNum();
+
+    _netlist.finalize(_cellNum);
+    // CELL statements without one of the cells: unit weights
+    bool cellWeighted = false;
+    cellWeight.resize(cellWeight.empty() ? 0 : _cellNum, 0);
+    for (auto &weight : cellWeight) {
+        weight = (weight == 0) ? 1 : weight;
+        cellWeighted |= (weight != 1);
+    }
+    if (cellWeighted) {
+        _netlist.setCellWeights(cellWeight);
+    }
+    if (netWeighted) {
+        _netlist.setNetWeights(netWeight);
+    }
     return;
 }
 
+void Partitioner::loadCache(const char* data, const size_t size)
+{
+    CacheHeader header;
+    memcpy(&header, data, sizeof(header));
+    if (header.version != CACHE_VERSION || header.headerSize != sizeof(CacheHeader)
+        || header.payloadSize != size - sizeof(CacheHeader)) {
+        cerr << "Unsupported or truncated netlist cache (version " << header.version
+             << "). The program will be terminated..." << endl;
+        exit(1);
+    }
+    if (header.cellNum < 0 || header.netNum < 0 || header.pinNum < 0) {
+        cerr << "Corrupted netlist cache header. The program will be terminated..." << endl;
+        exit(1);
+    }
+    // sections in writeCache() order
+    const uint64_t cellNum = header.cellNum, netNum = header.netNum, pinNum = header.pinNum;
+    const uint64_t sectionSize[] = {
+        4 * (netNum + 1), 4 * pinNum, 4 * (cellNum + 1), 4 * pinNum,
+        4 * (cellNum + 1), header.cellNameBytes, 4 * (netNum + 1), header.netNameBytes,
+        (header.flags & CACHE_CELL_WEIGHT) ? 4 * cellNum : 0, (header.flags & CACHE_NET_WEIGHT) ? 4 * netNum : 0
+    };
+    uint64_t expectSize = 0;
+    for (const auto &bytes : sectionSize) {
+        expectSize += bytes + padSize(bytes);
+    }
+    if (header.payloadSize != expectSize) {
+        cerr << "Corrupted netlist cache header. The program will be terminated..." << endl;
+        exit(1);
+    }
+    const char* pos = data + sizeof(CacheHeader);
+    if (checksum(pos, header.payloadSize) != header.checksum) {
+        cerr << "Netlist cache checksum mismatch. The program will be terminated..." << endl;
+        exit(1);
+    }
+
+    // start of each section, checking its zero padding
+    bool valid = ((uintptr_t)pos % CACHE_ALIGN == 0);
+    const char* section[sizeof(sectionSize) / sizeof(sectionSize[0])];
+    for (size_t k = 0; k < sizeof(sectionSize) / sizeof(sectionSize[0]); ++k) {
+        section[k] = pos;
+        pos += sectionSize[k];
+        for (const char* const end = pos + padSize(sectionSize[k]); pos < end; ++pos) {
+            valid &= (*pos == 0);
+        }
+    }
+    _bFactor = header.bFactor;
+    _netBFactor = _bFactor;
+    _cellNum = header.cellNum;
+    _netNum = header.netNum;
+    const int* const netCellOffset = (const int*)section[0];
+    const int* const netCellPin = (const int*)section[1];
+    const int* const cellNetOffset = (const int*)section[2];
+    const int* const cellNetPin = (const int*)section[3];
+    const uint32_t* const cellNameOffset = (const uint32_t*)section[4];
+    const char* const cellNamePool = section[5];
+    const uint32_t* const netNameOffset = (const uint32_t*)section[6];
+    const char* const netNamePool = section[7];
+    const int* const cellWeight = (const int*)section[8];
+    const int* const netWeight = (const int*)section[9];
+
+    // the checksum only catches damage: the lists must also be consistent
+    valid = valid && validOffsets(netCellOffset, _netNum, pinNum) && validOffsets(cellNetOffset, _cellNum, pinNum)
+         && validIds(netCellPin, pinNum, _cellNum) && validIds(cellNetPin, pinNum, _netNum)
+         && validOffsets(cellNameOffset, _cellNum, header.cellNameBytes)
+         && validOffsets(netNameOffset, _netNum, header.netNameBytes);
+    for (uint64_t k = 0; valid && (header.flags & CACHE_CELL_WEIGHT) && k < cellNum; ++k) {
+        valid = (cellWeight[k] > 0);
+    }
+    for (uint64_t k = 0; valid && (header.flags & CACHE_NET_WEIGHT) && k < netNum; ++k) {
+        valid = (netWeight[k] > 0);
+    }
+    if (!valid) {
+        cerr << "Corrupted netlist cache. The program will be terminated..." << endl;
+        exit(1);
+    }
+
+    _netlist.getNetCells().assign(netCellOffset, _netNum, netCellPin, header.pinNum);
+    _netlist.getCellNets().assign(cellNetOffset, _cellNum, cellNetPin, header.pinNum);
+    _netlist.finalize(_cellNum, false);
+    if (header.flags & CACHE_CELL_WEIGHT) {
+        _netlist.setCellWeights(vector<int>(cellWeight, cellWeight + _cellNum));
+    }
+    if (header.flags & CACHE_NET_WEIGHT) {
+        _netlist.setNetWeights(vector<int>(netWeight, netWeight + _netNum));
+    }
+    _cellNames.assign(cellNamePool, cellNameOffset, _cellNum);
+    _netNames.assign(netNamePool, netNameOffset, _netNum);
+    return;
+}
+
+template<class T>
+static void appendSection(string& buff, const vector<T>& section)
+{
+    buff.append((const char*)section.data(), section.size() * sizeof(T));
+    buff.append(padSize(buff.size()), '\0');
+}
+
+bool Partitioner::writeCache(const char* cacheFileName) const
+{
+    // the low-memory mode keeps no net names to save
+    if (_netNames.size() != _netNum) {
+        return false;
+    }
+    // payload
+    string payload;
+    appendSection(payload, _netlist.getNetCells().getOffsets());
+    appendSection(payload, _netlist.getNetCells().getPins());
+    appendSection(payload, _netlist.getCellNets().getOffsets());
+    appendSection(payload, _netlist.getCellNets().getPins());
+    appendSection(payload, _cellNames.getOffsets());
+    appendSection(payload, _cellNames.getPool());
+    appendSection(payload, _netNames.getOffsets());
+    appendSection(payload, _netNames.getPool());
+    appendSection(payload, _netlist.getCellWeights());
+    appendSection(payload, _netlist.getNetWeights());
+
+    CacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = CACHE_VERSION;
+    header.headerSize = sizeof(CacheHeader);
+    header.payloadSize = payload.size();
+    header.checksum = checksum(payload.data(), payload.size());
+    header.bFactor = _netBFactor;
+    header.cellNum = _cellNum;
+    header.netNum = _netNum;
+    header.pinNum = _netlist.getPinNum();
+    header.cellNameBytes = _cellNames.getPool().size();
+    header.netNameBytes = _netNames.getPool().size();
+    header.flags = (_netlist.isWeighted() ? CACHE_CELL_WEIGHT : 0) | (_netlist.isNetWeighted() ? CACHE_NET_WEIGHT : 0);
+
+    fstream cacheFile(cacheFileName, ios::out | ios::binary);
+    if (!cacheFile) {
+        return false;
+    }
+    cacheFile.write((const char*)&header, sizeof(header));
+    cacheFile.write(payload.data(), payload.size());
+    return (bool)cacheFile;
+}
+
 
 void Partitioner::printSummary() const
 {
@@ -74,8 +733,17 @@ void Partitioner::printSummary() const
     cout << " Cutsize: " << _cutSize << endl;
     cout << " Total cell number: " << _cellNum << endl;
     cout << " Total net number:  " << _netNum << endl;
-    cout << " Cell Number of partition A: " << _partSize[0] << endl;
-    cout << " Cell Number of partition B: " << _partSize[1] << endl;
+    if (_partNum > 2) {
+        for (int p = 0; p < _partNum; ++p) {
+            cout << " Cell " << (_graph->isWeighted() ? "Weight" : "Number") << " of partition G"
+                 << p+1 << ": " << _kPartSize[p] << endl;
+        }
+    }
+    else {
+        const char* sizeName = _graph->isWeighted() ? " Cell Weight" : " Cell Number";
+        cout << sizeName << " of partition A: " << _partSize[0] << endl;
+        cout << sizeName << " of partition B: " << _partSize[1] << endl;
+    }
     cout << "=================================================" << endl;
     cout << endl;
     return;
@@ -84,11 +752,11 @@ void Partitioner::printSummary() const
 void Partitioner::reportNet() const
 {
     cout << "Number of nets: " << _netNum << endl;
-    for (size_t i = 0, end_i = _netArray.size(); i < end_i; ++i) {
-        cout << setw(8) << _netArray[i]->getName() << ": ";
-        vector<int> cellList = _netArray[i]->getCellList();
-        for (size_t j = 0, end_j = cellList.size(); j < end_j; ++j) {
-            cout << setw(8) << _cellArray[cellList[j]]->getName() << " ";
+    for (int i = 0; i < _netNum; ++i) {
+        cout << setw(8) << getNetName(i) << ": ";
+        const IdRange cellList = getCellList(i);
+        for (int j = 0, end_j = cellList.size(); j < end_j; ++j) {
+            cout << setw(8) << getCellName(cellList[j]) << " ";
         }
         cout << endl;
     }
@@ -98,11 +766,11 @@ void Partitioner::reportNet() const
 void Partitioner::reportCell() const
 {
     cout << "Number of cells: " << _cellNum << endl;
-    for (size_t i = 0, end_i = _cellArray.size(); i < end_i; ++i) {
-        cout << setw(8) << _cellArray[i]->getName() << ": ";
-        vector<int> netList = _cellArray[i]->getNetList();
-        for (size_t j = 0, end_j = netList.size(); j < end_j; ++j) {
-            cout << setw(8) << _netArray[netList[j]]->getName() << " ";
+    for (int i = 0; i < _cellNum; ++i) {
+        cout << setw(8) << getCellName(i) << ": ";
+        const IdRange netList = getNetList(i);
+        for (int j = 0, end_j = netList.size(); j < end_j; ++j) {
+            cout << setw(8) << getNetName(netList[j]) << " ";
         }
         cout << endl;
     }
@@ -111,91 +779,201 @@ void Partitioner::reportCell() const
 
 void Partitioner::writeResult(fstream& outFile)
 {
-    stringstream buff;
-    buff << _cutSize;
-    outFile << "Cutsize = " << buff.str() << '\n';
-    buff.str("");
-    buff << _partSize[0];
-    outFile << "G1 " << buff.str() << '\n';
-    for (size_t i = 0, end = _cellArray.size(); i < end; ++i) {
-        if (_cellArray[i]->getPart() == 0) {
-            outFile << _cellArray[i]->getName() << " ";
+    // one walk over the cells appends each name to the buffer of its part;
+    // every group then goes out with a single write
+    const size_t byteNum = _cellNames.getPool().size() + _cellNum;
+    vector<string> group(_partNum);
+    vector<int> cellNum(_partNum, 0);   // part sizes are weights, the result lists cell numbers
+    for (int p = 0; p < _partNum; ++p) {
+        group[p].reserve(byteNum / _partNum + byteNum / 8 + 16);
+    }
+    for (int i = 0; i < _cellNum; ++i) {
+        const int p = getKWayPart(i);
+        const string_view name = getCellName(i);
+        group[p].append(name.data(), name.size());
+        group[p] += ' ';
+        ++cellNum[p];
+    }
+    string head = "Cutsize = " + to_string(_cutSize) + '\n';
+    outFile.write(head.data(), head.size());
+    for (int p = 0; p < _partNum; ++p) {
+        head = "G" + to_string(p+1) + " " + to_string(cellNum[p]) + '\n';
+        outFile.write(head.data(), head.size());
+        group[p] += ";\n";
+        outFile.write(group[p].data(), group[p].size());
+        string().swap(group[p]);
+    }
+    return;
+}
+
+bool Partitioner::writePartIds(const char* fileName) const
+{
+    // ".bin": PART_MAGIC, cell number, part number, then one byte per cell
+    // (int32 when partNum > 256) in cell id order; otherwise one
+    // "<cell> <part>" line per cell, the format read by readFixed()
+    const size_t len = strlen(fileName);
+    const bool binary = len >= 4 && strcmp(fileName + len - 4, ".bin") == 0;
+    string buff;
+    if (binary) {
+        const uint32_t head[2] = { (uint32_t)_cellNum, (uint32_t)_partNum };
+        const size_t idBytes = (_partNum > 256) ? sizeof(int32_t) : 1;
+        buff.reserve(sizeof(PART_MAGIC) + sizeof(head) + idBytes * _cellNum);
+        buff.append(PART_MAGIC, sizeof(PART_MAGIC));
+        buff.append((const char*)head, sizeof(head));
+        for (int i = 0; i < _cellNum; ++i) {
+            const int32_t p = getKWayPart(i);
+            buff.append((const char*)&p, idBytes);
         }
     }
-    outFile << ";\n";
-    buff.str("");
-    buff << _partSize[1];
-    outFile << "G2 " << buff.str() << '\n';
-    for (size_t i = 0, end = _cellArray.size(); i < end; ++i) {
-        if (_cellArray[i]->getPart() == 1) {
-            outFile << _cellArray[i]->getName() << " ";
+    else {
+        buff.reserve(_cellNames.getPool().size() + 8 * (size_t)_cellNum);
+        char num[16];
+        for (int i = 0; i < _cellNum; ++i) {
+            const string_view name = getCellName(i);
+            buff.append(name.data(), name.size());
+            buff += ' ';
+            buff.append(num, to_chars(num, num + sizeof(num), getKWayPart(i)).ptr);
+            buff += '\n';
         }
     }
-    outFile << ";\n";
-    return;
+    fstream partFile(fileName, ios::out | ios::binary);
+    if (!partFile) {
+        return false;
+    }
+    partFile.write(buff.data(), buff.size());
+    return (bool)partFile;
 }
 
 void Partitioner::clear()
 {
-    for (size_t i = 0, end = _cellArray.size(); i < end; ++i) {
-        delete _cellArray[i];
-    }
-    for (size_t i = 0, end = _netArray.size(); i < end; ++i) {
-        delete _netArray[i];
+    _cellNames.clear();
+    _netNames.clear();
+    _netlist.clear();
+    return;
+}
+
+void Partitioner::initBond()
+{
+    const double totalWeight = _graph->getTotalWeight();
+    _bond[0] = _targetRatio*(1-_bFactor)*totalWeight;
+    _bond[1] = (1-_targetRatio)*(1-_bFactor)*totalWeight;
+    return;
+}
+
+void Partitioner::initGraph()
+{
+    _cellNum = _graph->getCellNum();
+    _netNum = _graph->getNetNum();
+    // gains, cuts and part weights are ints: the weight sums must fit
+    // (Pmax and any cut are at most the total net weight)
+    if (_graph->getTotalNetWeight() > INT_MAX || _graph->getTotalWeight() > INT_MAX) {
+        cerr << "Net or cell weights sum to more than " << INT_MAX
+             << ". The program will be terminated..." << endl;
+        exit(1);
     }
+    // Pmax: gain of any cell lies in [-Pmax, +Pmax] (sum of its net weights)
+    _maxPinNum = _graph->getMaxGain();
+    // gains lie in [-Pmax, Pmax] and net counts are at most the net size:
+    // 16 bits hold them on most netlists (all of input_pa1)
+    _state.init(_cellNum, _netNum, _maxPinNum <= INT16_MAX && _graph->getMaxNetSize() <= INT16_MAX);
+    _journalStamp.assign(_lowMemory ? 0 : _netNum, 0);
+    _passStamp = 0;
     return;
 }
 
-void Partitioner::partition()
+void Partitioner::partition(const vector<unsigned char>* initAssign)
 {
     /*set balance bond*/
-    _bond = (1-_bFactor)/2*_cellNum;;
+    initBond();
 
     /* init partition */
-    initPart(0);
+    initPart(0, initAssign);
+    if(_verbose){
+        cout << "Initial cutsize: " << _cutSize << endl;
+    }
+    // nets left out of the gains (the final cut size still counts them)
+    if(_skipNetSize > 0){
+        int largeNetNum = 0;
+        long long largePinNum = 0;
+        for(int netId=0; netId < _netNum; ++netId){
+            if(isLargeNet(netId)){
+                ++largeNetNum;
+                largePinNum += _graph->getNetSize(netId);
+            }
+        }
+        STATS_COUNT(_stats, COUNT_LARGE_PIN, largePinNum);
+        if(_verbose){
+            cout << "Large nets: " << largeNetNum << " nets with " << largePinNum << " pins left out of the gains" << endl;
+        }
+    }
 
     /* iterate */
     while(1){
         // init tracing record
         _moveStack.clear();
+        _journal.clear();
+        ++_passStamp;
+        STATS_RUN(const chrono::steady_clock::time_point passStart = chrono::steady_clock::now();)
 
         // iterate
         ++_iterNum;
-        while(_unlockNum[0]+_unlockNum[1]!=0){
-            iterate();
+        const int maxMoveNum = (_passLimit.moveRatio > 0) ? max(1, (int)(_passLimit.moveRatio*_cellNum)) : INT_MAX;
+        const int stallMoveNum = (_passLimit.stallMoveNum > 0) ? _passLimit.stallMoveNum : INT_MAX;
+        {
+            STATS_TIMER(_stats, PHASE_MOVE);
+            while(_maxGainCell != NIL_CELL && _unlockNum[0]+_unlockNum[1]!=0){
+                if(!iterate()){
+                    break;
+                }
+                // early exit: the best prefix is rarely found late in the pass
+                if(_moveNum - _bestMoveNum >= stallMoveNum || _moveNum >= maxMoveNum){
+                    break;
+                }
+            }
+        }
+        // no balanced move at all in this pass / no prefix with a positive gain
+        if(_moveNum == 0 || _maxAccGain < 0){
+            _maxAccGain = 0;
+            _bestMoveNum = 0;
         }
 
-        // for all partial sum of _maxAccGain=0 then stop iterating
-        if(_maxAccGain == 0){
-            // recover to the best
-            for(int round=_moveNum-1; round>_bestMoveNum-1; --round){ 
-                const int cellId = _moveStack[round];
-                const bool part = _cellArray[cellId]->getPart();
-                moveCell(cellId, part);
-                // cout << "trace back to moving "<< _cellArray[cellId]->getName() << endl;
+        // recover to the best
+        rollback();
+        _cutSize -= _maxAccGain;
+        STATS_COUNT(_stats, COUNT_MOVE, _moveNum);
+        STATS_RUN(
+            const PassRecord record = {_iterNum, chrono::duration<double>(chrono::steady_clock::now() - passStart).count(),
+                                       _moveNum, _bestMoveNum, _maxAccGain, _cutSize};
+            _stats.addPass(record);
+        )
+
+        // for all partial sum of _maxAccGain=0 (or out of passes) then stop iterating
+        if(_maxAccGain == 0 || _iterNum == _maxIterNum){
+            // gains ignored the large nets: count the cut exactly
+            if(_skipNetSize > 0){
+                _cutSize = countCutSize();
             }
-            _cutSize -= _maxAccGain;
+            STATS_COUNT(_stats, COUNT_NET_VISIT, _netVisitNum);
+            STATS_COUNT(_stats, COUNT_NET_SKIP, _lockedSkipNum + _largeSkipNum);
 
-            cout << "Total iterations: "<< _iterNum << endl;
+            if(_verbose){
+                cout << "Total iterations: "<< _iterNum << endl;
+                cout << "Net visits: " << _netVisitNum << " walked, " << _lockedSkipNum
+                     << " skipped (locked), " << _largeSkipNum << " skipped (large)" << endl;
+            }
             // printSummary();
             return;
         }
 
-        // reset all cells
-        for(const auto &item : _cellArray){
-            item->unlock();
-            ++_unlockNum[item->getPart()];
-            item->setGain(0);
-        }
-
-        // recover to the best
-        for(int round=_moveNum-1; round>_bestMoveNum-1; --round){ 
+        // reset the moved (locked) cells, the others are still unlocked
+        for(int round=0; round<_moveNum; ++round){
             const int cellId = _moveStack[round];
-            const bool part = _cellArray[cellId]->getPart();
-            moveCell(cellId, part);
-            // cout << "trace back to moving "<< _cellArray[cellId]->getName() << endl;
+            _state.unlock(cellId);
+            ++_unlockNum[_state.getPart(cellId)];
+            for(const auto &item : getNetList(cellId)){
+                _state.clearLockCount(item);
+            }
         }
-        _cutSize -= _maxAccGain;
         // cout << _iterNum << endl;
         // printSummary();
 
@@ -203,70 +981,663 @@ void Partitioner::partition()
     }
 }
 
-void Partitioner::initPart(const bool iter){
-    if(iter == 0){
-        // step1: place cells in each party balanced
-        int balance = _cellNum/2;
-        for(size_t i=0; i < balance; ++i){
-            ++_partSize[1];
-            ++_unlockNum[1];
-            _cellArray[i]->setPart(1);
-            for(const auto &item : _cellArray[i]->getNetList()){
-                _netArray[item]->incPartCount(1);
+void Partitioner::partition(const PartitionConfig& config)
+{
+    // the arrays keep their size between runs on the same netlist, so a new
+    // run only overwrites them
+    _bFactor = (config.bFactor < 0) ? _netBFactor : config.bFactor;
+    _passLimit = config.passLimit;
+    _skipNetSize = config.skipNetSize;
+    _maxIterNum = config.maxIterNum;
+    _partNum = 2;
+    _initMethod = config.initMethod;
+    _threadNum = max(1, config.threadNum);
+    _parallelRefine = config.parallelRefine;
+    if (config.partNum > 2) {
+        partitionKWay(config.partNum, config.threadNum, config.seed, config.multilevel);
+    }
+    else if (config.startNum > 1) {
+        partitionMultiStart(config.startNum, min(config.threadNum, config.startNum), config.seed, config.multilevel);
+    }
+    else if (config.multilevel) {
+        partitionMultilevel(config.seed);
+    }
+    else if (config.initAssign == NULL && config.initMethod != INIT_ORDER) {
+        mt19937 rng(config.seed);
+        vector<unsigned char> assign;
+        generateInit(config.initMethod, rng, assign);
+        if (_parallelRefine) {
+            refineParallel(&assign, config.seed);
+        }
+        else {
+            partition(&assign);
+        }
+    }
+    else if (_parallelRefine) {
+        refineParallel(config.initAssign, config.seed);
+    }
+    else {
+        partition(config.initAssign);
+    }
+    return;
+}
+
+void Partitioner::checkAssign(const vector<unsigned char>& assign) const
+{
+    if (assign.size() != (size_t)_cellNum) {
+        cerr << "Invalid initial partition of " << assign.size() << " cells for " << _cellNum
+             << " cells. The program will be terminated..." << endl;
+        exit(1);
+    }
+    for (int c = 0; c < _cellNum; ++c) {
+        if (assign[c] > 1) {
+            cerr << "Invalid initial part " << (int)assign[c] << " of cell " << c
+                 << ". The program will be terminated..." << endl;
+            exit(1);
+        }
+    }
+}
+
+void Partitioner::refineParallel(const vector<unsigned char>* initAssign, const unsigned seed)
+{
+    initBond();
+    initPart(0, initAssign);
+    vector<unsigned char> assign(_cellNum);
+    for (int c = 0; c < _cellNum; ++c) {
+        assign[c] = _state.getPart(c);
+    }
+    ParallelRefiner refiner(*_graph, _bFactor, _targetRatio, _threadNum);
+    refiner.setFixedParts(_fixedPart);
+    refiner.setMaxRoundNum(_maxIterNum);
+    {
+        STATS_TIMER(_stats, PHASE_PARALLEL);
+        refiner.refine(assign, seed);
+    }
+    STATS_RUN(_stats.merge(refiner.getStats());)
+    setPartition(assign);
+    // exact over all nets, also with _skipNetSize
+    _cutSize = refiner.getCutSize();
+    if (_verbose) {
+        cout << "Parallel refinement: " << refiner.getRoundNum() << " rounds, "
+             << refiner.getLPMoveNum() << " label propagation / " << refiner.getFMMoveNum()
+             << " localized FM moves, cutsize " << refiner.getInitCutSize() << " -> " << _cutSize << endl;
+    }
+    return;
+}
+
+void Partitioner::rollback()
+{
+    STATS_TIMER(_stats, PHASE_ROLLBACK);
+    STATS_COUNT(_stats, COUNT_ROLLBACK, _moveNum - _bestMoveNum);
+    // two ways back to the best prefix, take the one with fewer net updates:
+    // undo the moves after it, or restore the journaled counts and replay the kept moves
+    // (the low-memory mode keeps no journal and always undoes)
+    long long undoCost = 0;
+    long long replayCost = _journal.size() / 3;
+    for(int round=0; round<_moveNum; ++round){
+        const int netNum = getNetList(_moveStack[round]).size();
+        if(round < _bestMoveNum){
+            replayCost += netNum;
+        }else{
+            undoCost += netNum;
+        }
+    }
+    if(_lowMemory || undoCost <= replayCost){
+        for(int round=_moveNum-1; round>_bestMoveNum-1; --round){
+            const int cellId = _moveStack[round];
+            moveCell(cellId, _state.getPart(cellId));
+        }
+        return;
+    }
+
+    for(size_t i=0, end=_journal.size(); i<end; i+=3){
+        _state.setPartCount(_journal[i], 0, _journal[i+1]);
+        _state.setPartCount(_journal[i], 1, _journal[i+2]);
+    }
+    for(int round=_bestMoveNum; round<_moveNum; ++round){
+        const int cellId = _moveStack[round];
+        const bool part = _state.getPart(cellId);
+        const int weight = _graph->getCellWeight(cellId);
+        _partSize[part] -= weight;
+        _partSize[!part] += weight;
+        _state.move(cellId);
+    }
+    for(int round=0; round<_bestMoveNum; ++round){
+        const int cellId = _moveStack[round];
+        const bool part = _state.getPart(cellId);
+        for(const auto &item : getNetList(cellId)){
+            _state.decPartCount(item, !part);
+            _state.incPartCount(item, part);
+        }
+    }
+}
+
+void Partitioner::generateInit(const InitMethod method, mt19937& rng, vector<unsigned char>& assign) const
+{
+    const InitPartitioner generator(*_graph, _targetRatio, &_fixedPart);
+    switch (method) {
+        case INIT_RANDOM:
+            generator.random(rng, assign);
+            break;
+        case INIT_GROW:
+            generator.grow(rng, assign);
+            break;
+        case INIT_LP:
+            // clusters small against the balance slack, like coarse cells
+            generator.propagate(rng, max(1, (int)(_bFactor * _graph->getTotalWeight() / 4)), assign);
+            break;
+        default:
+            assign.clear();
+            break;
+    }
+}
+
+void Partitioner::partitionMultilevel(const unsigned seed)
+{
+    mt19937 rng(seed);
+
+    // coarse cells stay small against the balance slack so every level can be balanced
+    const double totalWeight = _graph->getTotalWeight();
+    const double maxWeight = min(1.5 * totalWeight / COARSEST_CELL_NUM, _bFactor * totalWeight / 4);
+    const int maxCellWeight = max(1, (int)maxWeight);
+
+    // coarsening: level 0 is _graph, level i is graphs[i-1], cellMaps[i-1] maps level i-1 to i
+    // (fixedParts[i] are the fixed parts of level i, coarse cells of a fixed cell stay fixed)
+    vector<Hypergraph> graphs;
+    vector<vector<int> > cellMaps;
+    vector<vector<int> > fixedParts(1, _fixedPart);
+    graphs.reserve(MAX_LEVEL_NUM);
+    cellMaps.reserve(MAX_LEVEL_NUM);
+    const Hypergraph* fine = _graph;
+    while (fine->getCellNum() > COARSEST_CELL_NUM && (int)graphs.size() < MAX_LEVEL_NUM) {
+        STATS_TIMER(_stats, PHASE_COARSEN);
+        Hypergraph coarse;
+        vector<int> cellMap;
+        const vector<int>& fineFixed = fixedParts.back();
+        const int coarseNum = Coarsener(*fine, maxCellWeight, &fineFixed).coarsen(coarse, cellMap, rng);
+        // stop when matching stalls
+        if (coarseNum > 0.95 * fine->getCellNum()) {
+            break;
+        }
+        vector<int> coarseFixed;
+        if (!fineFixed.empty()) {
+            coarseFixed.assign(coarseNum, -1);
+            for (size_t c = 0, end = cellMap.size(); c < end; ++c) {
+                if (fineFixed[c] >= 0) {
+                    coarseFixed[cellMap[c]] = fineFixed[c];
+                }
             }
         }
-        for(size_t i=balance; i < _cellNum; ++i){
-            ++_partSize[0];
-            ++_unlockNum[0];
-            // _cellArray[i]->setPart(0); // already initiated
-            for(const auto &item : _cellArray[i]->getNetList()){
-                _netArray[item]->incPartCount(0);
+        graphs.push_back(std::move(coarse));
+        cellMaps.push_back(std::move(cellMap));
+        fixedParts.push_back(std::move(coarseFixed));
+        fine = &graphs.back();
+    }
+    const int levelNum = graphs.size();
+
+    // initial partition: best of several random starts refined by FM on the coarsest level
+    vector<unsigned char> assign, bestAssign;
+    int bestCut = INT_MAX;
+    {
+        Partitioner coarsest(levelNum > 0 ? &graphs.back() : _graph, _bFactor);
+        coarsest.setVerbose(false);
+        coarsest.setPassLimit(_passLimit);
+        coarsest.setSkipNetSize(_skipNetSize);
+        coarsest.setTargetRatio(_targetRatio);
+        coarsest.setFixedParts(fixedParts.back());
+        for (int t = 0; t < INIT_PART_TRY_NUM; ++t) {
+            InitPartitioner(coarsest.getGraph(), _targetRatio).random(rng, assign);
+            coarsest.partition(&assign);
+            if (coarsest.getCutSize() < bestCut) {
+                bestCut = coarsest.getCutSize();
+                for (int c = 0, end = coarsest.getCellNum(); c < end; ++c) {
+                    assign[c] = coarsest.getPart(c);
+                }
+                bestAssign.swap(assign);
             }
         }
+        STATS_RUN(_stats.merge(coarsest.getStats());)
+    }
+    if (_verbose) {
+        cout << "Multilevel: " << levelNum << " levels, coarsest " << fine->getCellNum()
+             << " cells, initial cutsize " << bestCut << endl;
+    }
 
-        // init cutSize
-        for(const auto &item : _netArray){
-            if(item->getPartCount(0)>0 && item->getPartCount(1)>0){
-                ++_cutSize;
+    // uncoarsening: project to the finer level and refine with FM
+    PassLimit refineLimit = _passLimit;
+    if (refineLimit.stallMoveNum == 0) {
+        refineLimit.stallMoveNum = REFINE_STALL_NUM;
+    }
+    for (int level = levelNum; level > 0; --level) {
+        const vector<int>& cellMap = cellMaps[level-1];
+        assign.resize(cellMap.size());
+        for (size_t c = 0, end = cellMap.size(); c < end; ++c) {
+            assign[c] = bestAssign[cellMap[c]];
+        }
+        if (level == 1) {
+            bestAssign.swap(assign);
+            break;
+        }
+        if (_parallelRefine) {
+            ParallelRefiner refiner(graphs[level-2], _bFactor, _targetRatio, _threadNum);
+            refiner.setFixedParts(fixedParts[level-1]);
+            refiner.setMaxRoundNum(REFINE_ITER_NUM);
+            {
+                STATS_TIMER(_stats, PHASE_PARALLEL);
+                refiner.refine(assign, seed);
             }
+            STATS_RUN(_stats.merge(refiner.getStats());)
+            bestAssign.swap(assign);
+            continue;
         }
+        Partitioner refiner(&graphs[level-2], _bFactor);
+        refiner.setVerbose(false);
+        refiner.setPassLimit(refineLimit);
+        refiner.setSkipNetSize(_skipNetSize);
+        refiner.setTargetRatio(_targetRatio);
+        refiner.setFixedParts(fixedParts[level-1]);
+        refiner.setMaxIterNum(REFINE_ITER_NUM);
+        refiner.partition(&assign);
+        STATS_RUN(_stats.merge(refiner.getStats());)
+        for (int c = 0, end = refiner.getCellNum(); c < end; ++c) {
+            assign[c] = refiner.getPart(c);
+        }
+        bestAssign.swap(assign);
+    }
+    if (_parallelRefine) {
+        refineParallel(&bestAssign, seed);
+    }
+    else {
+        // the finest level gets the same capped passes
+        const PassLimit passLimit = _passLimit;
+        const int maxIterNum = _maxIterNum;
+        _passLimit = refineLimit;
+        _maxIterNum = (maxIterNum > 0) ? min(maxIterNum, REFINE_ITER_NUM) : REFINE_ITER_NUM;
+        partition(&bestAssign);
+        _passLimit = passLimit;
+        _maxIterNum = maxIterNum;
+    }
+    return;
+}
 
-        // init iterNum
-        _iterNum = 0;
+// seed of start i, independent of the thread that runs it (splitmix64)
+static unsigned deriveSeed(const unsigned seed, const int start)
+{
+    uint64_t z = ((uint64_t)seed << 32) + start + 0x9e3779b97f4a7c15ULL;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return (unsigned)(z ^ (z >> 31));
+}
+
+void Partitioner::partitionMultiStart(const int startNum, const int threadNum,
+                                      const unsigned seed, const bool multilevel)
+{
+    // best result of each thread; ties go to the lower start index
+    struct Result
+    {
+        int                     cutSize;
+        int                     start;
+        vector<unsigned char>   assign;
+    };
+    vector<Result> best(threadNum);
+    vector<int> startCut(startNum, -1);
+    atomic<int> nextStart(0);
+
+    auto worker = [&](const int t) {
+        // each thread owns its partition state, the netlist is shared read-only
+        Partitioner runner(_graph, _bFactor);
+        runner.setVerbose(false);
+        runner.setPassLimit(_passLimit);
+        runner.setSkipNetSize(_skipNetSize);
+        runner.setTargetRatio(_targetRatio);
+        runner.setFixedParts(_fixedPart);
+        runner.setInitMethod(_initMethod);
+        runner.setMaxIterNum(_maxIterNum);
+        vector<unsigned char> assign;
+        best[t].cutSize = INT_MAX;
+        best[t].start = -1;
+        for (int i = nextStart++; i < startNum; i = nextStart++) {
+            const unsigned startSeed = deriveSeed(seed, i);
+            if (multilevel) {
+                runner.partitionMultilevel(startSeed);
+            }
+            else {
+                mt19937 rng(startSeed);
+                runner.generateInit((_initMethod == INIT_GROW || _initMethod == INIT_LP) ? _initMethod : INIT_RANDOM,
+                                    rng, assign);
+                runner.partition(&assign);
+            }
+            if (!runner.isBalanced()) {
+                continue;
+            }
+            const int cutSize = runner.getCutSize();
+            startCut[i] = cutSize;
+            if (cutSize < best[t].cutSize || (cutSize == best[t].cutSize && i < best[t].start)) {
+                best[t].cutSize = cutSize;
+                best[t].start = i;
+                best[t].assign.resize(_cellNum);
+                for (int c = 0; c < _cellNum; ++c) {
+                    best[t].assign[c] = runner.getPart(c);
+                }
+            }
+        }
+        STATS_RUN(
+            lock_guard<mutex> lock(statsMutex);
+            _stats.merge(runner.getStats());
+        )
+    };
+    vector<thread> pool;
+    for (int t = 1; t < threadNum; ++t) {
+        pool.emplace_back(worker, t);
+    }
+    worker(0);
+    for (auto &th : pool) {
+        th.join();
     }
 
-    // step2: initiate gain
-    for(const auto &item : _netArray){
-        for(const auto &it : item->getCellList()){           
-            Cell* const cell = _cellArray[it];
-            const bool from = cell->getPart();
-            const int FromCount = item->getPartCount(from);
-            const int ToCount = item->getPartCount(!from);
+    int bestThread = -1;
+    for (int t = 0; t < threadNum; ++t) {
+        if (best[t].start == -1) {
+            continue;
+        }
+        if (bestThread == -1 || best[t].cutSize < best[bestThread].cutSize
+            || (best[t].cutSize == best[bestThread].cutSize && best[t].start < best[bestThread].start)) {
+            bestThread = t;
+        }
+    }
+    if (_verbose) {
+        for (int i = 0; i < startNum; ++i) {
+            cout << "Start " << i << " (seed " << deriveSeed(seed, i) << "): ";
+            if (startCut[i] < 0) {
+                cout << "unbalanced" << endl;
+            }
+            else {
+                cout << "cutsize " << startCut[i] << endl;
+            }
+        }
+    }
+    if (bestThread == -1) {
+        cerr << "No balanced partition found in " << startNum << " starts." << endl;
+        partition();
+        return;
+    }
+    if (_verbose) {
+        cout << "Multi-start: " << startNum << " starts on " << threadNum << " threads, best cutsize "
+             << best[bestThread].cutSize << " (start " << best[bestThread].start << ")" << endl;
+    }
+    setPartition(best[bestThread].assign);
+    return;
+}
 
-            // From = 1 => Gain++
-            if(FromCount == 1){
-                cell->incGain();
+// hypergraph induced by "cells" of "graph" (local cell i is cells[i]);
+// nets keep their pins inside and are dropped with fewer than 2 of them
+static void extractSubgraph(const Hypergraph& graph, const vector<int>& cells, Hypergraph& sub)
+{
+    vector<int> localId(graph.getCellNum(), -1);
+    for (int i = 0, end = cells.size(); i < end; ++i) {
+        localId[cells[i]] = i;
+    }
+    vector<unsigned char> visited(graph.getNetNum(), 0);
+    vector<int> netWeight;
+    sub.clear();
+    for (const auto &c : cells) {
+        for (const auto &n : graph.getNetList(c)) {
+            if (visited[n]) {
+                continue;
             }
-            // To = 0 => Gain--
-            if(ToCount == 0){
-                cell->decGain();
-            }  
+            visited[n] = 1;
+            int pinNum = 0;
+            for (const auto &pin : graph.getCellList(n)) {
+                pinNum += (localId[pin] != -1);
+            }
+            if (pinNum < 2) {
+                continue;
+            }
+            for (const auto &pin : graph.getCellList(n)) {
+                if (localId[pin] != -1) {
+                    sub.addPin(localId[pin]);
+                }
+            }
+            sub.closeNet();
+            if (graph.isNetWeighted()) {
+                netWeight.push_back(graph.getNetWeight(n));
+            }
+        }
+    }
+    sub.finalize(cells.size());
+    if (graph.isNetWeighted()) {
+        sub.setNetWeights(netWeight);
+    }
+    if (graph.isWeighted()) {
+        vector<int> weight(cells.size());
+        for (int i = 0, end = cells.size(); i < end; ++i) {
+            weight[i] = graph.getCellWeight(cells[i]);
         }
+        sub.setCellWeights(weight);
+    }
+}
 
+void Partitioner::partitionKWay(const int partNum, const int threadNum,
+                                const unsigned seed, const bool multilevel)
+{
+    // recursive bisection, every level takes an equal share of the imbalance
+    _partNum = partNum;
+    _kPart.assign(_cellNum, 0);
+    const int levelNum = max(1, (int)ceil(log2((double)partNum)));
+    const double levelFactor = 1 - pow(1 - _bFactor, 1.0 / levelNum);
+    vector<int> cells(_cellNum);
+    for (int c = 0; c < _cellNum; ++c) {
+        cells[c] = c;
+    }
+    {
+        STATS_TIMER(_stats, PHASE_BISECT);
+        bisect(*_graph, cells, _fixedPart, 0, partNum, 1, threadNum, levelFactor, seed, multilevel);
+    }
+
+    // direct k-way FM on the whole netlist
+    KWayRefiner refiner(*_graph, partNum, _bFactor);
+    refiner.setFixedParts(_fixedPart);
+    refiner.setPassLimit(_passLimit);
+    refiner.setMaxIterNum(_maxIterNum);
+    {
+        STATS_TIMER(_stats, PHASE_KWAY);
+        refiner.refine(_kPart);
+    }
+    STATS_RUN(_stats.merge(refiner.getStats());)
+    _cutSize = refiner.getCutSize();
+    _kPartSize.resize(partNum);
+    for (int p = 0; p < partNum; ++p) {
+        _kPartSize[p] = refiner.getPartWeight(p);
+    }
+    for (int c = 0; c < _cellNum; ++c) {
+        _kPart[c] = refiner.getPart(c);
+    }
+    if (_verbose) {
+        cout << "K-way: " << partNum << " parts, recursive bisection cutsize " << refiner.getInitCutSize()
+             << ", k-way FM cutsize " << _cutSize << " (" << refiner.getIterNum() << " passes)" << endl;
+        if (!refiner.isBalanced()) {
+            cerr << "The " << partNum << "-way partition violates the balance factor." << endl;
+        }
+    }
+    return;
+}
+
+void Partitioner::bisect(const Hypergraph& graph, const vector<int>& cells, const vector<int>& fixedPart,
+                         const int firstPart, const int partNum, const int node, const int threadNum, const double bFactor, const unsigned seed,
+                         const bool multilevel)
+{
+    if (partNum == 1) {
+        for (const auto &c : cells) {
+            _kPart[c] = firstPart;
+        }
+        return;
     }
 
-    // build bList
-    for(const auto &item : _cellArray){
-        Node* const it = item->getNode();
-        const int gain = item->getGain();
+    // 2-way split, A takes leftNum of the partNum parts
+    const int leftNum = partNum / 2;
+    vector<int> side[2];
+    {
+        Partitioner bisector(&graph, bFactor);
+        bisector.setVerbose(false);
+        bisector.setPassLimit(_passLimit);
+        bisector.setSkipNetSize(_skipNetSize);
+        bisector.setTargetRatio((double)leftNum / partNum);
+        bisector.setMaxIterNum(BISECT_ITER_NUM);
+        if (!fixedPart.empty()) {
+            vector<int> fixedSide(fixedPart.size(), -1);
+            for (size_t c = 0, end = fixedPart.size(); c < end; ++c) {
+                if (fixedPart[c] >= 0) {
+                    fixedSide[c] = (fixedPart[c] >= firstPart + leftNum);
+                }
+            }
+            bisector.setFixedParts(fixedSide);
+        }
+        if (multilevel) {
+            bisector.partitionMultilevel(deriveSeed(seed, node));
+        }
+        else {
+            bisector.partition();
+        }
+        STATS_RUN(
+            lock_guard<mutex> lock(statsMutex);
+            _stats.merge(bisector.getStats());
+        )
+        for (int c = 0, end = graph.getCellNum(); c < end; ++c) {
+            side[bisector.getPart(c)].push_back(c);
+        }
+    }
 
-        if(_maxGainCell == NULL){
-            _maxGainCell = it;
+    // the two halves are independent subproblems (node numbers keep the seeds thread independent)
+    auto split = [&](const int party, const int splitThreadNum) {
+        Hypergraph subgraph;
+        extractSubgraph(graph, side[party], subgraph);
+        vector<int> subcells(side[party].size());
+        vector<int> subfixed(fixedPart.empty() ? 0 : side[party].size());
+        for (int i = 0, end = subcells.size(); i < end; ++i) {
+            subcells[i] = cells[side[party][i]];
         }
-        addNode(it, item->getPart(), gain);
-        if(gain >= _cellArray[_maxGainCell->getId()]->getGain()){
-            _maxGainCell = it;
+        for (int i = 0, end = subfixed.size(); i < end; ++i) {
+            subfixed[i] = fixedPart[side[party][i]];
         }
+        bisect(subgraph, subcells, subfixed, party ? firstPart + leftNum : firstPart,
+               party ? partNum - leftNum : leftNum, 2*node + party, splitThreadNum, bFactor, seed, multilevel);
+    };
+    if (threadNum > 1) {
+        thread worker(split, 1, threadNum / 2);
+        split(0, threadNum - threadNum / 2);
+        worker.join();
+    }
+    else {
+        split(0, 1);
+        split(1, 1);
+    }
+    return;
+}
+
+void Partitioner::setPartition(const vector<unsigned char>& assign)
+{
+    initBond();
+    initPart(0, &assign);
+    return;
+}
+
+void Partitioner::selectKernel(){
+    static const IterateKernel KERNEL[8] = {
+        &Partitioner::iterateKernel<false, false, false>, &Partitioner::iterateKernel<false, false, true>,
+        &Partitioner::iterateKernel<false, true, false>,  &Partitioner::iterateKernel<false, true, true>,
+        &Partitioner::iterateKernel<true, false, false>,  &Partitioner::iterateKernel<true, false, true>,
+        &Partitioner::iterateKernel<true, true, false>,   &Partitioner::iterateKernel<true, true, true>
+    };
+    _iterateKernel = KERNEL[4*_graph->isNetWeighted() + 2*_graph->isWeighted() + (_skipNetSize > 0)];
+}
+
+void Partitioner::initPart(const bool iter, const vector<unsigned char>* initAssign){
+    if(iter == 0){
+        // a given solution (partition(), setPartition(), PartitionConfig::initAssign)
+        // needs a part 0 / 1 for every cell
+        if(initAssign != NULL){
+            checkAssign(*initAssign);
+        }
+        selectKernel();
+        _state.reset();
+        _cutSize = 0;
+        _maxGainCell = NIL_CELL;
+        for(int party=0; party<2; ++party){
+            _partSize[party] = 0;
+            _unlockNum[party] = 0;
+        }
+
+        // step1: place cells in each party balanced (first half -> B) or as given;
+        // fixed cells take their side and stay locked for good
+        int balance = (1-_targetRatio)*_cellNum;
+        for(int i=0; i < _cellNum && !_fixedPart.empty(); ++i){
+            balance -= (_fixedPart[i] == 1);
+        }
+        for(int i=0; i < _cellNum; ++i){
+            bool party;
+            if(isFixed(i)){
+                party = _fixedPart[i];
+                _state.lock(i);
+                for(const auto &item : getNetList(i)){
+                    _state.fixLock(item, party);
+                }
+            }
+            else{
+                party = (initAssign != NULL) ? (*initAssign)[i] : (balance-- > 0);
+                ++_unlockNum[party];
+            }
+            _state.setPart(i, party);
+            _partSize[party] += _graph->getCellWeight(i);
+            for(const auto &item : getNetList(i)){
+                _state.incPartCount(item, party);
+            }
+        }
+
+        // init cutSize
+        _cutSize = countCutSize();
+        _netVisitNum = 0;
+        _lockedSkipNum = 0;
+        _largeSkipNum = 0;
+
+        // init iterNum
+        _iterNum = 0;
+    }
+
+    // step2: initiate gain (between passes only the cells around moved cells can change)
+    {
+        STATS_TIMER(_stats, PHASE_GAIN);
+        if(iter == 0 || _moveNum > _cellNum/4){
+            // most cells moved: the net-centric sweep is cheaper
+            computeGains();
+        }else{
+            updateGains();
+#ifdef FM_DEBUG
+            verifyGains();
+#endif
+        }
+    }
+
+    // build bList (fixed cells never enter it)
+    STATS_TIMER(_stats, PHASE_BUCKET);
+    initBList();
+    for(int cellId=0; cellId < _cellNum; ++cellId){
+        if(isFixed(cellId)){
+            continue;
+        }
+        const int gain = _state.getGain(cellId);
+
+        if(_maxGainCell == NIL_CELL){
+            _maxGainCell = cellId;
+        }
+        addNode(cellId, _state.getPart(cellId), gain);
+        if(gain >= _state.getGain(_maxGainCell)){
+            _maxGainCell = cellId;
+        }
+    }
+    // the first move must keep the balance as well
+    if(_maxGainCell != NIL_CELL
+       && _partSize[_state.getPart(_maxGainCell)] - _graph->getCellWeight(_maxGainCell) < _bond[_state.getPart(_maxGainCell)]){
+        selectMaxGainCell();
     }
 
     // init iter para
@@ -278,17 +1649,140 @@ void Partitioner::initPart(const bool iter){
     // printSummary();
 }
 
-void Partitioner::iterate(){
+int Partitioner::countCutSize() const{
+    int cutSize = 0;
+    for(int netId=0; netId < _netNum; ++netId){
+        if(_state.getPartCount(netId, 0)>0 && _state.getPartCount(netId, 1)>0){
+            cutSize += _graph->getNetWeight(netId);
+        }
+    }
+    return cutSize;
+}
+
+int Partitioner::cellGain(const int cellId) const{
+    const bool from = _state.getPart(cellId);
+    int gain = 0;
+    for(const auto &item : getNetList(cellId)){
+        if(isLargeNet(item)){
+            continue;
+        }
+        // From = 1 => Gain++ / To = 0 => Gain-- (by the net weight)
+        gain += _graph->getNetWeight(item)
+              * ((_state.getPartCount(item, from) == 1) - (_state.getPartCount(item, !from) == 0));
+    }
+    return gain;
+}
+
+void Partitioner::computeGains(){
+    // large netlists: cell-centric over threads (each thread owns a range of
+    // cells and only reads the net counts, integer sums give the same gains)
+    const int threadNum = sweepThreadNum(_threadNum);
+    if(threadNum > 1 && _cellNum >= PARALLEL_GAIN_CELL_NUM){
+        auto sweep = [this](const int begin, const int end){
+            for(int cellId=begin; cellId<end; ++cellId){
+                _state.setGain(cellId, cellGain(cellId));
+            }
+        };
+        vector<thread> pool;
+        for(int t=1; t<threadNum; ++t){
+            pool.emplace_back(sweep, (long long)_cellNum*t/threadNum, (long long)_cellNum*(t+1)/threadNum);
+        }
+        sweep(0, _cellNum/threadNum);
+        for(auto &th : pool){
+            th.join();
+        }
+        return;
+    }
+    _state.resetGains();
+    for(int netId=0; netId < _netNum; ++netId){
+        if(isLargeNet(netId)){
+            continue;
+        }
+        const int netWeight = _graph->getNetWeight(netId);
+        for(const auto &it : getCellList(netId)){
+            const bool from = _state.getPart(it);
+            const int FromCount = _state.getPartCount(netId, from);
+            const int ToCount = _state.getPartCount(netId, !from);
+
+            // From = 1 => Gain++
+            if(FromCount == 1){
+                _state.incGain(it, netWeight);
+            }
+            // To = 0 => Gain--
+            if(ToCount == 0){
+                _state.decGain(it, netWeight);
+            }  
+        }
+    }
+}
+
+void Partitioner::updateGains(){
+    // every move of the last pass (kept or rolled back) may change the gain of
+    // the cells sharing a net with the moved cell; all other gains are unchanged
+    if(_cellStamp.size() != (size_t)_cellNum || _netStamp.size() != (size_t)_netNum){
+        _cellStamp.assign(_cellNum, 0);
+        _netStamp.assign(_netNum, 0);
+        _stamp = 0;
+    }
+    ++_stamp;
+    for(int round=0; round<_moveNum; ++round){
+        for(const auto &item : getNetList(_moveStack[round])){
+            if(_netStamp[item] == _stamp || isLargeNet(item)){
+                continue;
+            }
+            _netStamp[item] = _stamp;
+            for(const auto &it : getCellList(item)){
+                if(_cellStamp[it] != _stamp){
+                    _cellStamp[it] = _stamp;
+                    _state.setGain(it, cellGain(it));
+                    STATS_COUNT(_stats, COUNT_GAIN_UPDATE, 1);
+                }
+            }
+        }
+    }
+}
+
+void Partitioner::verifyGains(){
+    vector<int> gain(_cellNum);
+    for(int cellId=0; cellId < _cellNum; ++cellId){
+        gain[cellId] = _state.getGain(cellId);
+    }
+    computeGains();
+    int mismatchNum = 0;
+    for(int cellId=0; cellId < _cellNum; ++cellId){
+        if(gain[cellId] != _state.getGain(cellId)){
+            ++mismatchNum;
+        }
+    }
+    if(mismatchNum > 0){
+        cerr << "Incremental gain mismatch in iteration " << _iterNum << ": "
+             << mismatchNum << " cells" << endl;
+        abort();
+    }
+}
+
+bool Partitioner::iterate(){
+    return (this->*_iterateKernel)();
+}
+
+// FM step specialized on the shape of the netlist: unit net / cell weights
+// and no large nets fold to constants, so the common case drops their lookups
+// and branches (fixed cells need no variant, they only show as lock counts)
+template <bool NetWeighted, bool CellWeighted, bool SkipLarge>
+bool Partitioner::iterateKernel(){
+    const int* const netWeights = _graph->getNetWeights().data();
+    auto netWeight = [netWeights](const int netId){ return NetWeighted ? netWeights[netId] : 1; };
+    auto isLarge = [this](const int netId){ return SkipLarge && _graph->getNetSize(netId) > _skipNetSize; };
+
     // step1: decide FromSide and lock _maxGainCell
-    const int maxGainCellId = _maxGainCell->getId();
-    Cell* const maxGainCell = _cellArray[maxGainCellId];
-    const int maxGainCellGain = _cellArray[maxGainCellId]->getGain();
-    const bool From = _cellArray[maxGainCellId]->getPart();
+    const int maxGainCellId = _maxGainCell;
+    const int maxGainCellGain = _state.getGain(maxGainCellId);
+    const int From = _state.getPart(maxGainCellId);
+    const int To = 1 - From;
 
     // lock maxGainCell
-    rmNode(_maxGainCell, From, maxGainCellGain);
-    maxGainCell->lock();
-    // cout << _cellArray[_maxGainCell->getId()]->getName() << " is locked: " << maxGainCell->getLock() << endl;
+    rmNode(maxGainCellId, From, maxGainCellGain);
+    _state.lock(maxGainCellId);
     --_unlockNum[From];
 
     // update _accGain and _maxAccGain in this iteration
@@ -305,262 +1799,197 @@ void Partitioner::iterate(){
 
     // step2: update gain for each node before move
     // before _maxGainCell moves => ToCount=0:gain++ / ToCount=1:gain(to)--
-    for(const auto &item : maxGainCell->getNetList()){
-        const int FromCount = _netArray[item]->getPartCount(From);
-        const int ToCount = _netArray[item]->getPartCount(!From);
+    // (a walk is skipped when every cell it could update is locked)
+    for(const auto &item : getNetList(maxGainCellId)){
+        const int FromCount = _state.getPartCount(item, From);
+        const int ToCount = _state.getPartCount(item, To);
+        // journal the counts of the net before its first change in the pass
+        if(!_lowMemory && _journalStamp[item] != _passStamp){
+            _journalStamp[item] = _passStamp;
+            _journal.push_back(item);
+            _journal.push_back(_state.getPartCount(item, 0));
+            _journal.push_back(_state.getPartCount(item, 1));
+        }
+        if(ToCount > 1){
+            continue;
+        }
+        if(isLarge(item)){
+            ++_largeSkipNum;
+            continue;
+        }
         if(ToCount == 0){
+            // unlocked cells left in From besides maxGainCell
+            if(FromCount - 1 - _state.getLockCount(item, From) == 0){
+                ++_lockedSkipNum;
+                continue;
+            }
+            ++_netVisitNum;
+            const int w = netWeight(item);
             // update bList[all] && ToCount=0:gain++
-            for(const auto &it : _netArray[item]->getCellList()){
-                Cell* const cell = _cellArray[it];
-                if(cell->getLock() == 0){
-                    Node* const node = cell->getNode();
-                    const bool party = cell->getPart();
-                    rmNode(node, party, cell->getGain());
-                    cell->incGain();
-                    addNode(node, party, cell->getGain());
+            for(const auto &it : getCellList(item)){
+                if(_state.getLock(it) == 0){
+                    const int party = _state.getPart(it);
+                    rmNode(it, party, _state.getGain(it));
+                    _state.incGain(it, w);
+                    STATS_COUNT(_stats, COUNT_GAIN_UPDATE, 1);
+                    addNode(it, party, _state.getGain(it));
                 }
             }
         }
-        if(ToCount == 1){
-            // update bList[!From] && ToCount=1:gain(to)--
-            for(const auto &it : _netArray[item]->getCellList()){
-                Cell* const cell = _cellArray[it];
-                if(cell->getPart() == (!From) && cell->getLock() == 0){
-                    Node* const node = cell->getNode();
-                    const bool party = cell->getPart();
-                    rmNode(node, party, cell->getGain());
-                    cell->decGain();
-                    addNode(node, party, cell->getGain());
+        else{
+            if(_state.getLockCount(item, To) == 1){
+                ++_lockedSkipNum;
+                continue;
+            }
+            ++_netVisitNum;
+            const int w = netWeight(item);
+            // update bList[To] && ToCount=1:gain(to)--
+            for(const auto &it : getCellList(item)){
+                if(_state.getPart(it) == To && _state.getLock(it) == 0){
+                    rmNode(it, To, _state.getGain(it));
+                    _state.decGain(it, w);
+                    STATS_COUNT(_stats, COUNT_GAIN_UPDATE, 1);
+                    addNode(it, To, _state.getGain(it));
                 }
             }
         }
     }
 
     // step3: move _maxGainCell
-    moveCell(maxGainCellId, From);
+    const int weight = CellWeighted ? _graph->getCellWeights()[maxGainCellId] : 1;
+    _partSize[From] -= weight;
+    _partSize[To] += weight;
+    _state.move(maxGainCellId);
     _moveStack.emplace_back(maxGainCellId);
 
-    // step4: update gain for each node before move
+    // step4: update the counts of each net (maxGainCell is now a locked cell
+    // of To) and the gains after the move
     // After _maxGainCell moves => FromCount=0:gain-- / FromCount=1:gain(from)++
-    for(const auto &item : maxGainCell->getNetList()){
-        const int FromCount = _netArray[item]->getPartCount(From);
-        const int ToCount = _netArray[item]->getPartCount(!From);
+    for(const auto &item : getNetList(maxGainCellId)){
+        _state.decPartCount(item, From);
+        _state.incPartCount(item, To);
+        _state.incLockCount(item, To);
+        const int FromCount = _state.getPartCount(item, From);
+        if(FromCount > 1){
+            continue;
+        }
+        if(isLarge(item)){
+            ++_largeSkipNum;
+            continue;
+        }
         if(FromCount == 0){
+            // unlocked cells in To
+            if(_state.getPartCount(item, To) - _state.getLockCount(item, To) == 0){
+                ++_lockedSkipNum;
+                continue;
+            }
+            ++_netVisitNum;
+            const int w = netWeight(item);
             // update bList[all] && FromCount=0:gain--
-            for(const auto &it : _netArray[item]->getCellList()){
-                Cell* const cell = _cellArray[it];
-                if(cell->getLock() == 0){
-                    Node* node = cell->getNode();
-                    bool party = cell->getPart();
-                    rmNode(node, party, cell->getGain());
-                    cell->decGain();
-                    addNode(node, party, cell->getGain());
+            for(const auto &it : getCellList(item)){
+                if(_state.getLock(it) == 0){
+                    const int party = _state.getPart(it);
+                    rmNode(it, party, _state.getGain(it));
+                    _state.decGain(it, w);
+                    STATS_COUNT(_stats, COUNT_GAIN_UPDATE, 1);
+                    addNode(it, party, _state.getGain(it));
                 }
             }
         }
-        if(FromCount == 1){
+        else{
+            if(_state.getLockCount(item, From) == 1){
+                ++_lockedSkipNum;
+                continue;
+            }
+            ++_netVisitNum;
+            const int w = netWeight(item);
             // update bList[From] && FromCount=1:gain(from)++
-            for(const auto &it : _netArray[item]->getCellList()){
-                Cell* const cell = _cellArray[it];
-                if(cell->getPart() == From && cell->getLock() == 0){
-                    Node* node = cell->getNode();
-                    bool party = cell->getPart();
-                    rmNode(node, party, cell->getGain());
-                    cell->incGain();
-                    addNode(node, party, cell->getGain());
+            for(const auto &it : getCellList(item)){
+                if(_state.getPart(it) == From && _state.getLock(it) == 0){
+                    rmNode(it, From, _state.getGain(it));
+                    _state.incGain(it, w);
+                    STATS_COUNT(_stats, COUNT_GAIN_UPDATE, 1);
+                    addNode(it, From, _state.getGain(it));
                 }
             }
         }
     }
 
     // step5: select new _maxGainCell for the next iteration
-    const int part0SizeAftermoved = _partSize[0]-1;
-    const int part1SizeAftermoved = _partSize[1]-1;
-    const bool bucket0Empty = _bList[0].empty();
-    const bool bucket1Empty = _bList[1].empty();
-    // no candidates
-    if(bucket0Empty && bucket1Empty){
-        // cout <<"G0 && G1 are both empty"<< endl;
-        // printBList();
-        // printSummary();
-        return;
-    }else{
-        if(bucket1Empty){
-            // check if G0 is movable
-            if(part0SizeAftermoved >= _bond){
-                // only G0 is movable
-                map<int, Node*>::reverse_iterator maxBucketGain0 = _bList[0].rbegin();
-                
-                // maxGain in _bList[0] for maxGain
-                _maxGainCell = maxBucketGain0->second;
-                // cout <<"max in G0 "<< _cellArray[_maxGainCell->getId()]->getName() << " " << _cellArray[_maxGainCell->getId()]->getGain() << endl;
-            }else{
-                // G0 is unmovable
-                // cout <<"G1 is empty, but G0 is unmovable"<< endl;
-                // printBList();
-                return;
-            }
-
-        }else{
-            if(bucket0Empty){
-                // check if G1 is movable
-                if(part1SizeAftermoved >= _bond){
-                    // only G1 is movable
-                    map<int, Node*>::reverse_iterator maxBucketGain1 = _bList[1].rbegin();
-
-                    // maxGain in _bList[1] for maxGain
-                    _maxGainCell = maxBucketGain1->second;
-                    // cout <<"max in G1 "<< _cellArray[_maxGainCell->getId()]->getName() << " " << _cellArray[_maxGainCell->getId()]->getGain() << endl;
-                }else{
-                    // cout <<"G0 is empty, but G1 is unmovable"<< endl;
-                    // printBList();
-                    // printSummary();
-                    return;
-                }
+    return selectMaxGainCell();
+}
 
-            }else{
-                // 4 conditions
-                if(part0SizeAftermoved >= _bond && part1SizeAftermoved >= _bond){
-                    // G1 G2 are both movable
-                    map<int, Node*>::reverse_iterator maxBucketGain0 = _bList[0].rbegin(); 
-                    map<int, Node*>::reverse_iterator maxBucketGain1 = _bList[1].rbegin();
-
-                    // compare and chose _maxGainCell
-                    if(maxBucketGain0->first >= maxBucketGain1->first){
-                        _maxGainCell = maxBucketGain0->second;
-                    }
-                    else{
-                        _maxGainCell = maxBucketGain1->second;
-                    }
-                    // cout <<"max "<< _cellArray[_maxGainCell->getId()]->getName() << " " << _cellArray[_maxGainCell->getId()]->getGain() << endl;
-                }else{
-                    if(part0SizeAftermoved >= _bond){
-                        // only G0 is movable
-                        map<int, Node*>::reverse_iterator maxBucketGain0 = _bList[0].rbegin();
-                        
-                        // maxGain in _bList[0] for maxGain
-                        _maxGainCell = maxBucketGain0->second;
-                        // cout <<"max in G0 "<< _cellArray[_maxGainCell->getId()]->getName() << " " << _cellArray[_maxGainCell->getId()]->getGain() << endl;
-                    }else{
-                        if(part1SizeAftermoved >= _bond){
-                            // only G1 is movable
-                            map<int, Node*>::reverse_iterator maxBucketGain1 = _bList[1].rbegin();
-
-                            // maxGain in _bList[1] for maxGain
-                            _maxGainCell = maxBucketGain1->second;
-                            // cout <<"max in G1 "<< _cellArray[_maxGainCell->getId()]->getName() << " " << _cellArray[_maxGainCell->getId()]->getGain() << endl;
-                        }else{
-                            // cout <<"G0 && G1 are not empty, but are both not movable"<< endl;
-                            // printBList();
-                            // printSummary();
-                            return;
-                        }
-                    }
-                }
-            }
+bool Partitioner::selectMaxGainCell(){
+    // a party is movable if its max gain cell can leave without breaking the balance
+    bool movable[2];
+    int maxBucketGain[2];
+    for(int party=0; party<2; ++party){
+        movable[party] = false;
+        maxBucketGain[party] = NIL_CELL;
+        if(!isBListEmpty(party)){
+            maxBucketGain[party] = _bList.getFirst(party, _bList.getTopGain(party));
+            movable[party] = (_partSize[party] - _graph->getCellWeight(maxBucketGain[party]) >= _bond[party]);
         }
     }
 
-    // printBList();
-    // printSummary();
-}
-
-void Partitioner::addNode(Node* const node, const bool party, const int gain){
-    // bList -> [node]
-    if(getBList(party)[gain] == NULL){
-        _bList[party][gain] = node;
-        node->setNext(NULL);
-        node->setPrev(NULL);
-        // cout << "add bList["<< party <<"]["<< gain <<"] -> [" << _cellArray[node->getId()]->getName() << "]"<< endl;
-        return;
+    if(movable[0] && (!movable[1] || _bList.getTopGain(0) >= _bList.getTopGain(1))){
+        _maxGainCell = maxBucketGain[0];
+    }
+    else if(movable[1]){
+        _maxGainCell = maxBucketGain[1];
     }
-    // bList -> [node] -> node
     else{
-        node->setNext(_bList[party][gain]);
-        node->getNext()->setPrev(node);
-        node->setPrev(NULL);
-        _bList[party][gain] = node;
-        // cout << "add bList["<< party <<"]["<< gain <<"] -> [" << _cellArray[node->getId()]->getName() << "] -> " << _cellArray[node->getNext()->getId()]->getName() << endl;
-        return;
+        // no candidates / both unmovable
+        _maxGainCell = NIL_CELL;
+        return false;
     }
+    // cout <<"max "<< getCellName(_maxGainCell) << " " << _state.getGain(_maxGainCell) << endl;
+    return true;
+}
+
+void Partitioner::initBList(){
+    // gain ranges over [-Pmax, +Pmax] => 2*Pmax+1 buckets per party
+    _bList.init(2, _cellNum, _maxPinNum);
 }
 
-void Partitioner::rmNode(Node* const node, const bool party, const int gain){
-    Node* const next = node->getNext();
-    Node* const prev = node->getPrev();
+void Partitioner::addNode(const int cellId, const bool party, const int gain){
+    STATS_COUNT(_stats, COUNT_BUCKET_INSERT, 1);
+    _bList.add(party, cellId, gain);
+}
 
-    // bList -> node -> [node]
-    if(next == NULL && prev != NULL){
-        prev->setNext(NULL);
-        node->setPrev(NULL);
-        // cout << "remove bList["<< party <<"]["<< gain <<"] -> node -> [" << _cellArray[node->getId()]->getName() << "]" << endl;
-        return;
-    }    
-    // bList -> node -> [node] -> node
-    else if(next != NULL && prev != NULL){
-        prev->setNext(next);
-        next->setPrev(prev);
-        node->setNext(NULL);
-        node->setPrev(NULL);
-        // cout << "remove bList["<< party <<"]["<< gain <<"] -> node -> [" << _cellArray[node->getId()]->getName() << "] -> node" << endl;
-        return;
-    }
-    // bList -> [node] -> node
-    else if(next != NULL ){
-        _bList[party][gain] = next;
-        next->setPrev(NULL);
-        node->setNext(NULL);
-        // cout << "remove bList["<< party <<"]["<< gain <<"] -> [" << _cellArray[node->getId()]->getName() << "] -> node" << endl;
-        return;
-    }   
-    // bList -> [node]
-    else{
-		_bList[party].erase(gain);
-        // cout << "remove bList["<< party <<"]["<< gain <<"] -> [" << _cellArray[node->getId()]->getName() << "]" << endl;
-        return;
-    }
+void Partitioner::rmNode(const int cellId, const bool party, const int gain){
+    STATS_COUNT(_stats, COUNT_BUCKET_REMOVE, 1);
+    _bList.remove(party, cellId, gain);
 }
 
 void Partitioner::moveCell(const int id, const bool part){
     // update cutlist and net status
-    Cell* const cell = _cellArray[id];
-    for(const auto &item : cell->getNetList()){
-        Net* const net = _netArray[item];
-        net->decPartCount(part);
-        net->incPartCount(!part);
+    for(const auto &item : getNetList(id)){
+        _state.decPartCount(item, part);
+        _state.incPartCount(item, !part);
     }
     // update partSize and move cell
-    --_partSize[part];
-    cell->move();
-    ++_partSize[!part];
+    const int weight = _graph->getCellWeight(id);
+    _partSize[part] -= weight;
+    _state.move(id);
+    _partSize[!part] += weight;
 }
 
 void Partitioner::printBList(){
     cout << "\n------------------------------" << endl;
     cout << "<" << " iterate " << _iterNum  << " - " << _moveNum << " >" << endl;
-    cout << "Blist 0" << endl;
-    cout << getPartSize(0) << endl;
-    for(const auto &item : _bList[0]){
-        Node* node = item.second;
-        cout << item.first << " ";
-        while(node!=NULL){
-            cout << _cellArray[node->getId()]->getName() << " ";
-            node = node->getNext();
-        }
-        cout << endl;
-    }
-    cout << "\nBlist 1" << endl;
-    cout << getPartSize(1) << endl;
-    for(const auto &item : _bList[1]){
-        Node* node = item.second;
-        cout << item.first << " ";
-        while(node!=NULL){
-            cout << _cellArray[node->getId()]->getName() << " ";
-            node = node->getNext();
+    for(int party=0; party<2; ++party){
+        cout << (party ? "\nBlist 1" : "Blist 0") << endl;
+        cout << getPartSize(party) << endl;
+        for(int gain=_bList.getTopGain(party); gain>=-_maxPinNum; gain=_bList.getLowerGain(party, gain)){
+            cout << gain << " ";
+            for(int node=_bList.getFirst(party, gain); node!=NIL_CELL; node=_bList.getNext(node)){
+                cout << getCellName(node) << " ";
+            }
+            cout << endl;
         }
-        cout << endl;
     }
-    cout << "\nMaxGainCell: "<< _cellArray[_maxGainCell->getId()]->getName() << " Gain:" << _cellArray[_maxGainCell->getId()]->getGain() << endl;
+    cout << "\nMaxGainCell: "<< getCellName(_maxGainCell) << " Gain:" << _state.getGain(_maxGainCell) << endl;
     cout << "AccGain: " << _accGain << " / " << "MaxGain: " << _maxAccGain << endl; 
     cout << "------------------------------" << endl;
 }
@@ -3,20 +3,72 @@
 
 #include <fstream>
 #include <vector>
-#include <map>
-#include <unordered_map> // added
-#include "cell.h"
-#include "net.h"
+#include <string_view>
+#include "gainbuckets.h"
+#include "hypergraph.h"
+#include "initpartitioner.h"
+#include "mappedfile.h"
+#include "nametable.h"
+#include "partitionstate.h"
+#include "stats.h"
 using namespace std;
 
+// limits of one FM pass (0 = unlimited)
+struct PassLimit
+{
+    int         stallMoveNum;   // end the pass after this many moves without a new best prefix
+    double      moveRatio;      // end the pass after this fraction of the cells has moved
+
+    PassLimit() : stallMoveNum(0), moveRatio(0) { }
+};
+
+// one run of Partitioner::partition(config); the netlist is loaded once and
+// can be partitioned any number of times with different configurations
+struct PartitionConfig
+{
+    double      bFactor;        // balance factor (< 0 = the one of the netlist)
+    unsigned    seed;           // random seed of multilevel / multi-start / k-way runs
+    int         partNum;        // number of parts (> 2: k-way)
+    int         startNum;       // randomized starts, the best one is kept
+    int         threadNum;      // threads of multi-start / k-way runs and of large gain sweeps
+    bool        multilevel;     // coarsen, partition the coarsest level, refine with FM
+    int         maxIterNum;     // max FM passes (0 = until no gain)
+    int         skipNetSize;    // nets larger than this are ignored by gains (0 = off)
+    PassLimit   passLimit;      // early exit policy of each pass
+    InitMethod  initMethod;     // initial solution of flat runs (multi-start: random unless grow / lp)
+    const vector<unsigned char>* initAssign;    // initial 2-way solution of a flat run (overrides initMethod)
+    bool        parallelRefine; // refine flat / multilevel 2-way runs with threadNum threads (ParallelRefiner)
+
+    PartitionConfig() : bFactor(-1), seed(0), partNum(2), startNum(1), threadNum(1),
+                        multilevel(false), maxIterNum(0), skipNetSize(0), initMethod(INIT_ORDER), initAssign(NULL),
+                        parallelRefine(false) { }
+};
+
 class Partitioner
 {
 public:
     // constructor and destructor
-    Partitioner(fstream& inFile) :
+    // (threadNum threads parse large text netlists and compute gains;
+    // lowMemory keeps no net names, no cell name index and no rollback journal)
+    Partitioner(const char* inFileName, const int threadNum = 1, const bool lowMemory = false) :
         _cutSize(0), _netNum(0), _cellNum(0), _maxPinNum(0), _bFactor(0),
-        _accGain(0), _maxAccGain(0), _iterNum(0) {
-        parseInput(inFile);
+        _netBFactor(0), _maxGainCell(NIL_CELL), _graph(&_netlist), _netNames('n'), _cellNames('c'),
+        _accGain(0), _maxAccGain(0), _iterNum(0), _maxIterNum(0), _verbose(true), _skipNetSize(0),
+        _targetRatio(0.5), _partNum(2), _initMethod(INIT_ORDER), _iterateKernel(NULL),
+        _threadNum(max(1, threadNum)), _parallelRefine(false), _lowMemory(lowMemory) {
+        parseInput(inFileName);
+        _partSize[0] = 0;
+        _partSize[1] = 0;
+    }
+    // partition a hypergraph owned by the caller (a coarsened level, or a
+    // netlist shared read-only between runs), without names
+    Partitioner(const Hypergraph* graph, const double bFactor) :
+        _cutSize(0), _netNum(0), _cellNum(0), _maxPinNum(0), _bFactor(bFactor),
+        _netBFactor(bFactor), _maxGainCell(NIL_CELL), _graph(graph),
+        _accGain(0), _maxAccGain(0), _iterNum(0), _maxIterNum(0), _verbose(true), _skipNetSize(0),
+        _targetRatio(0.5), _partNum(2), _initMethod(INIT_ORDER), _iterateKernel(NULL),
+        _threadNum(1), _parallelRefine(false), _lowMemory(false) {
+        initGraph();
         _partSize[0] = 0;
         _partSize[1] = 0;
     }
@@ -30,56 +82,159 @@ public:
     int getCellNum() const          { return _cellNum; }
     double getBFactor() const       { return _bFactor; }
     int getPartSize(int part) const { return _partSize[part]; }
+    bool isBalanced() const         { return _partSize[0] >= _bond[0] && _partSize[1] >= _bond[1]; }
+    bool getPart(int cellId) const  { return _state.getPart(cellId); }
+    int getPartNum() const          { return _partNum; }
+    int getKWayPart(int cellId) const   { return (_partNum > 2) ? _kPart[cellId] : _state.getPart(cellId); }
+    const Hypergraph& getGraph() const    { return *_graph; }
+    IdRange getNetList(int cellId) const  { return _graph->getNetList(cellId); }
+    IdRange getCellList(int netId) const  { return _graph->getCellList(netId); }
+    string_view getCellName(int cellId) const   { return _cellNames.getName(cellId); }
+    string_view getNetName(int netId) const     { return (netId < _netNames.size()) ? _netNames.getName(netId) : string_view(); }
+    Stats& getStats()                           { return _stats; }
 
     // modify method
-    void parseInput(fstream& inFile);
-    void partition();
+    void parseInput(const char* inFileName);
+    bool writeCache(const char* cacheFileName) const;
+    // merge nets with the same cells into one net weighing their sum (cut sizes
+    // are unchanged), return the number of nets removed
+    int mergeDuplicateNets();
+    void setVerbose(const bool verbose)   { _verbose = verbose; }
+    void setMaxIterNum(const int num)     { _maxIterNum = num; }
+    void setPassLimit(const PassLimit& limit)   { _passLimit = limit; }
+    void setSkipNetSize(const int size)         { _skipNetSize = size; }
+    void setTargetRatio(const double ratio)     { _targetRatio = ratio; }
+    void setFixedParts(const vector<int>& fixedPart)    { _fixedPart = fixedPart; }
+    void setInitMethod(const InitMethod method)         { _initMethod = method; }
+    void setThreadNum(const int threadNum)              { _threadNum = max(1, threadNum); }
+    void setParallelRefine(const bool parallel)         { _parallelRefine = parallel; }
+    void readFixed(const char* fixedFileName, const int partNum);
+    void partition(const vector<unsigned char>* initAssign = NULL);
+    // reset the partition state and run "config" (fixed cells stay as set)
+    void partition(const PartitionConfig& config);
+    void partitionMultilevel(const unsigned seed = 0);
+    void partitionMultiStart(const int startNum, const int threadNum,
+                             const unsigned seed = 0, const bool multilevel = false);
+    void partitionKWay(const int partNum, const int threadNum,
+                       const unsigned seed = 0, const bool multilevel = false);
+    void setPartition(const vector<unsigned char>& assign);
 
     // member functions about reporting
     void printSummary() const;
     void reportNet() const;
     void reportCell() const;
     void writeResult(fstream& outFile);
+    bool writePartIds(const char* fileName) const;   // per-cell part ids (binary if *.bin)
 
     // added: bucket funtions
-    map<int, Node*> getBList(const bool party) const {return _bList[party];}
-    void addNode(Node* const node, const bool party, const int gain);
-    void rmNode(Node* const node, const bool party, const int gain);
+    const GainBuckets& getBList() const { return _bList; }
+    bool isBListEmpty(const bool party) const { return _bList.isEmpty(party); }
+    void initBList();
+    void addNode(const int cellId, const bool party, const int gain);
+    void rmNode(const int cellId, const bool party, const int gain);
     void printBList();
 
     // added: partitioning operation
-    void initPart(const bool iter);
-    void iterate();
+    void initPart(const bool iter, const vector<unsigned char>* initAssign = NULL);
+    void checkAssign(const vector<unsigned char>& assign) const;  // exits unless a 0 / 1 part per cell
+    bool iterate();
+    bool selectMaxGainCell();
+    bool isFixed(const int cellId) const  { return !_fixedPart.empty() && _fixedPart[cellId] >= 0; }
+    bool isLargeNet(const int netId) const {
+        return _skipNetSize > 0 && _graph->getNetSize(netId) > _skipNetSize;
+    }
+    int countCutSize() const;
+    int cellGain(const int cellId) const;
+    void computeGains();
+    void updateGains();
+    void verifyGains();
     void moveCell(const int id, const bool party);
 
 
 private:
+    typedef bool (Partitioner::*IterateKernel)();
+
     int                 _cutSize;                           // cut size
     int                 _partSize[2];                       // size (cell number) of partition A(0) and B(1)
     int                 _netNum;                            // number of nets
     int                 _cellNum;                           // number of cells
     int                 _maxPinNum;                         // Pmax for building bucket list
     double              _bFactor;                           // the balance factor to be met
-    Node*               _maxGainCell;                       // pointer to max gain cell
-    vector<Net*>        _netArray;                          // net array of the circuit
-    vector<Cell*>       _cellArray;                         // cell array of the circuit
-    map<int, Node*>     _bList[2];                // bucket list of partition A(0) and B(1) // revised
-    unordered_map<string, int>    _netName2Id;              // unordered_mapping from net name to id  // revised
-    unordered_map<string, int>    _cellName2Id;             // unordered_mapping from cell name to id // revised
+    double              _netBFactor;                        // the balance factor given with the netlist
+    int                 _maxGainCell;                       // id of max gain cell (NIL_CELL if none is movable)
+    Hypergraph          _netlist;                           // parsed netlist (unused if _graph is shared)
+    const Hypergraph*   _graph;                             // cell <-> net adjacency and cell weights
+    PartitionState      _state;                             // gain/part/lock of cells, part count of nets
+    NameTable           _netNames;                          // names of the nets (only used for reporting)
+    NameTable           _cellNames;                         // names of the cells, interned while parsing
+    GainBuckets         _bList;                             // bucket list of partition A(0) and B(1)
 
     int                 _accGain;                           // accumulative gain
     int                 _maxAccGain;                        // maximum accumulative gain
     int                 _moveNum;                           // number of cell movements
     int                 _iterNum;                           // number of iterations
+    int                 _maxIterNum;                        // max number of iterations (0 = until no gain)
     int                 _bestMoveNum;                       // store best number of movements
     int                 _unlockNum[2];                      // number of unlocked cells
     vector<int>         _moveStack;                         // history of cell movement
+    vector<int>         _cellStamp;                         // last gain update stamp of each cell
+    vector<int>         _netStamp;                          // last gain update stamp of each net
+    int                 _stamp;                             // current gain update stamp
+    vector<int>         _journal;                           // (net, A count, B count) before its first change in the pass
+    vector<int>         _journalStamp;                      // pass stamp of the journal entry of each net
+    int                 _passStamp;                         // current pass stamp
 
     // added
-    double              _bond;                              // Lower bond of bucket size
+    double              _bond[2];                           // Lower bond of bucket size of A(0) and B(1)
+    bool                _verbose;                           // print per-run messages
+    PassLimit           _passLimit;                         // early exit policy of each pass
+    int                 _skipNetSize;                       // nets larger than this are ignored by gains (0 = off)
+    long long           _netVisitNum;                       // cell list walks done by gain updates
+    long long           _lockedSkipNum;                     // walks skipped since all affected cells were locked
+    long long           _largeSkipNum;                      // walks skipped on large nets
+    double              _targetRatio;                       // target share of A(0) in the total cell weight
+    int                 _partNum;                           // number of parts (> 2 after partitionKWay)
+    vector<int>         _kPart;                             // part of each cell of a k-way partition
+    vector<int>         _kPartSize;                         // size of each part of a k-way partition
+    vector<int>         _fixedPart;                         // fixed part of each cell (-1 = free, empty = none fixed)
+    InitMethod          _initMethod;                        // initial solution generator (see PartitionConfig)
+    IterateKernel       _iterateKernel;                     // iterate() of the netlist shape of the run (see selectKernel)
+    int                 _threadNum;                         // threads of parsing, gain initialization and parallel refinement
+    bool                _parallelRefine;                    // refine 2-way runs with ParallelRefiner instead of FM passes
+    bool                _lowMemory;                         // low-memory mode (see the constructor)
+    Stats               _stats;                             // timers and counters (collected with FM_STATS)
 
     // Clean up partitioner
     void clear();
+
+    // not copyable: _graph may point into _netlist
+    Partitioner(const Partitioner&);
+    Partitioner& operator=(const Partitioner&);
+
+    // size the per-cell / per-net arrays after _graph is built
+    void initGraph();
+    // lower bonds of A and B from _bFactor and _targetRatio
+    void initBond();
+    // return to the best prefix of a pass
+    void rollback();
+    // FM step specialized on unit / weighted nets and cells and on large net skipping,
+    // picked once per run by selectKernel()
+    template <bool NetWeighted, bool CellWeighted, bool SkipLarge> bool iterateKernel();
+    void selectKernel();
+    // place "initAssign" (NULL: parse order) and refine it with ParallelRefiner
+    void refineParallel(const vector<unsigned char>* initAssign, const unsigned seed);
+    // initial solution of "method" (INIT_ORDER: empty, initPart() splits in parse order)
+    void generateInit(const InitMethod method, mt19937& rng, vector<unsigned char>& assign) const;
+    // split "graph" (cells[i] is the id of local cell i in _graph) into parts [firstPart, firstPart+partNum)
+    // (fixedPart: fixed part of each local cell in [0, k), may be empty)
+    void bisect(const Hypergraph& graph, const vector<int>& cells, const vector<int>& fixedPart,
+                const int firstPart, const int partNum, const int node, const int threadNum, const double bFactor, const unsigned seed,
+                const bool multilevel);
+
+    // parse a text netlist / load a binary cache into the netlist arrays
+    // (the text file is unmapped once its names are copied, before the adjacency is transposed)
+    void parseNetlist(MappedFile& inFile);
+    void loadCache(const char* data, const size_t size);
 };
 
 #endif  // PARTITIONER_H
@@ -0,0 +1,145 @@
+#ifndef PARTITIONSTATE_H
+#define PARTITIONSTATE_H
+
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+using namespace std;
+
+#define NIL_CELL (-1)   // null link of the bucket list
+
+// Array of ints stored in 16 bits when the caller knows every value fits
+// (narrow), else in 32 bits.
+class PackedArray
+{
+public:
+    // Constructor and destructor
+    PackedArray() : _narrow(false) { }
+    ~PackedArray() { }
+
+    void assign(const size_t size, const bool narrow) {
+        _narrow = narrow;
+        if (narrow) {
+            vector<int>().swap(_wide);
+            _short.assign(size, 0);
+        }
+        else {
+            vector<int16_t>().swap(_short);
+            _wide.assign(size, 0);
+        }
+    }
+    void reset() {
+        fill(_short.begin(), _short.end(), 0);
+        fill(_wide.begin(), _wide.end(), 0);
+    }
+    void clear() {
+        vector<int16_t>().swap(_short);
+        vector<int>().swap(_wide);
+    }
+    bool empty() const                      { return _short.empty() && _wide.empty(); }
+    size_t size() const                     { return _narrow ? _short.size() : _wide.size(); }
+    int get(const size_t i) const           { return _narrow ? _short[i] : _wide[i]; }
+    void set(const size_t i, const int v) {
+        if (_narrow) {
+            _short[i] = (int16_t)v;
+        }
+        else {
+            _wide[i] = v;
+        }
+    }
+    void add(const size_t i, const int v) {
+        if (_narrow) {
+            _short[i] += v;
+        }
+        else {
+            _wide[i] += v;
+        }
+    }
+
+private:
+    bool                _narrow;    // values kept in _short
+    vector<int16_t>     _short;     // 16-bit values (narrow)
+    vector<int>         _wide;      // 32-bit values
+};
+
+// Hot, per-pass state of a 2-way partition kept as dense arrays (one slot
+// per cell / net) so that the FM loop never dereferences heap objects.
+// Gains and net counts take 16 bits when Pmax and every net size fit.
+class PartitionState
+{
+public:
+    // Constructor and destructor
+    PartitionState() : _narrow(false) { }
+    ~PartitionState() { }
+
+    // Allocate the arrays for "cellNum" cells and "netNum" nets
+    // (narrow: every gain and net size is below 2^15)
+    void init(const int cellNum, const int netNum, const bool narrow) {
+        _narrow = narrow;
+        _gain.assign(cellNum, narrow);
+        _part.assign(cellNum, 0);
+        _lock.assign(cellNum, 0);
+        _partCount.assign(2 * (size_t)netNum, narrow);
+        _lockCount.assign(2 * (size_t)netNum, narrow);
+        _fixedCount.clear();
+    }
+
+    // Clear the arrays of a new run in place (no reallocation)
+    void reset() {
+        _gain.reset();
+        fill(_part.begin(), _part.end(), 0);
+        fill(_lock.begin(), _lock.end(), 0);
+        _partCount.reset();
+        _lockCount.reset();
+        _fixedCount.clear();
+    }
+
+    // Cell access methods
+    bool isNarrow() const               { return _narrow; }
+    int getGain(const int c) const      { return _gain.get(c); }
+    bool getPart(const int c) const     { return _part[c]; }
+    bool getLock(const int c) const     { return _lock[c]; }
+
+    // Cell set / modify methods
+    void setGain(const int c, const int gain)   { _gain.set(c, gain); }
+    void setPart(const int c, const bool part)  { _part[c] = part; }
+    void move(const int c)      { _part[c] = !_part[c]; }
+    void lock(const int c)      { _lock[c] = 1; }
+    void unlock(const int c)    { _lock[c] = 0; }
+    void incGain(const int c, const int w = 1)  { _gain.add(c, w); }
+    void resetGains()           { _gain.reset(); }
+    void decGain(const int c, const int w = 1)  { _gain.add(c, -w); }
+
+    // Net access / modify methods
+    int getPartCount(const int n, const int part) const     { return _partCount.get(2*(size_t)n + part); }
+    void setPartCount(const int n, const int part, const int count) { _partCount.set(2*(size_t)n + part, count); }
+    void incPartCount(const int n, const int part)  { _partCount.add(2*(size_t)n + part, 1); }
+    void decPartCount(const int n, const int part)  { _partCount.add(2*(size_t)n + part, -1); }
+    int getLockCount(const int n, const int part) const     { return _lockCount.get(2*(size_t)n + part); }
+    void incLockCount(const int n, const int part)  { _lockCount.add(2*(size_t)n + part, 1); }
+    // fixed cells stay counted as locked when the pass ends
+    // (the fixed counts are only allocated once a cell is fixed)
+    void fixLock(const int n, const int part) {
+        if (_fixedCount.empty()) {
+            _fixedCount.assign(_lockCount.size(), _narrow);
+        }
+        _lockCount.add(2*(size_t)n + part, 1);
+        _fixedCount.add(2*(size_t)n + part, 1);
+    }
+    void clearLockCount(const int n) {
+        const bool fixed = !_fixedCount.empty();
+        _lockCount.set(2*(size_t)n, fixed ? _fixedCount.get(2*(size_t)n) : 0);
+        _lockCount.set(2*(size_t)n + 1, fixed ? _fixedCount.get(2*(size_t)n + 1) : 0);
+    }
+
+private:
+    bool                    _narrow;    // gains and counts kept in 16 bits
+    PackedArray             _gain;      // gain of each cell
+    vector<unsigned char>   _part;      // partition each cell belongs to (0-A, 1-B)
+    vector<unsigned char>   _lock;      // whether each cell is locked
+    PackedArray             _partCount; // cell number of each net in A(2n) and B(2n+1)
+    PackedArray             _lockCount; // locked cell number of each net in A(2n) and B(2n+1)
+    PackedArray             _fixedCount;// fixed cell number of each net in A(2n) and B(2n+1) (empty = none fixed)
+};
+
+#endif  // PARTITIONSTATE_H
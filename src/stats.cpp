@@ -0,0 +1,76 @@
+#include <cstring>
+#include <fstream>
+#include "stats.h"
+
+using namespace std;
+
+static const char* const PHASE_NAME[PHASE_NUM] = {
+    "parse", "merge", "gain", "bucket", "move", "rollback", "coarsen", "bisect", "kway", "parallel", "total"
+};
+static const char* const COUNT_NAME[COUNT_NUM] = {
+    "moves", "gain_updates", "bucket_inserts", "bucket_removes", "net_visits", "net_skips", "rollback_moves",
+    "merged_pins", "large_net_pins"
+};
+
+
+void Stats::merge(const Stats& other)
+{
+    for (int p = 0; p < PHASE_NUM; ++p) {
+        _time[p] += other._time[p];
+    }
+    for (int c = 0; c < COUNT_NUM; ++c) {
+        _count[c] += other._count[c];
+    }
+}
+
+void Stats::clear()
+{
+    for (int p = 0; p < PHASE_NUM; ++p) {
+        _time[p] = 0;
+    }
+    for (int c = 0; c < COUNT_NUM; ++c) {
+        _count[c] = 0;
+    }
+    _pass.clear();
+}
+
+bool Stats::write(const char* fileName) const
+{
+    fstream report(fileName, ios::out);
+    if (!report) {
+        return false;
+    }
+    const size_t len = strlen(fileName);
+    if (len >= 4 && strcmp(fileName + len - 4, ".csv") == 0) {
+        report << "kind,name,seconds,count,moves,kept,gain,cutsize\n";
+        for (int p = 0; p < PHASE_NUM; ++p) {
+            report << "phase," << PHASE_NAME[p] << "," << _time[p] << ",,,,,\n";
+        }
+        for (int c = 0; c < COUNT_NUM; ++c) {
+            report << "counter," << COUNT_NAME[c] << ",," << _count[c] << ",,,,\n";
+        }
+        for (const auto &pass : _pass) {
+            report << "pass," << pass.pass << "," << pass.seconds << ",," << pass.moveNum << ","
+                   << pass.keptNum << "," << pass.gain << "," << pass.cutSize << "\n";
+        }
+        return (bool)report;
+    }
+
+    report << "{\n  \"phases\": {";
+    for (int p = 0; p < PHASE_NUM; ++p) {
+        report << (p ? ", " : "") << "\"" << PHASE_NAME[p] << "\": " << _time[p];
+    }
+    report << "},\n  \"counters\": {";
+    for (int c = 0; c < COUNT_NUM; ++c) {
+        report << (c ? ", " : "") << "\"" << COUNT_NAME[c] << "\": " << _count[c];
+    }
+    report << "},\n  \"passes\": [";
+    for (size_t i = 0; i < _pass.size(); ++i) {
+        const PassRecord& pass = _pass[i];
+        report << (i ? "," : "") << "\n    {\"pass\": " << pass.pass << ", \"seconds\": " << pass.seconds
+               << ", \"moves\": " << pass.moveNum << ", \"kept\": " << pass.keptNum
+               << ", \"gain\": " << pass.gain << ", \"cutsize\": " << pass.cutSize << "}";
+    }
+    report << (_pass.empty() ? "]\n}\n" : "\n  ]\n}\n");
+    return (bool)report;
+}
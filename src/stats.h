@@ -0,0 +1,112 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <chrono>
+#include <vector>
+using namespace std;
+
+// Wall-clock phase timers, per-pass records and hot-path counters of a run.
+// They are only collected when built with FM_STATS (make STATS=1); otherwise
+// every STATS_* macro below expands to nothing.
+
+enum StatPhase
+{
+    PHASE_PARSE,        // reading the netlist / cache
+    PHASE_MERGE,        // merging duplicate nets
+    PHASE_GAIN,         // initial gains and gain updates between passes
+    PHASE_BUCKET,       // building the bucket lists
+    PHASE_MOVE,         // moving cells inside the passes
+    PHASE_ROLLBACK,     // undoing the moves after the best prefix
+    PHASE_COARSEN,      // multilevel coarsening
+    PHASE_BISECT,       // k-way recursive bisection
+    PHASE_KWAY,         // k-way FM refinement
+    PHASE_PARALLEL,     // multi-threaded 2-way refinement
+    PHASE_TOTAL,        // whole program
+    PHASE_NUM
+};
+
+enum StatCounter
+{
+    COUNT_MOVE,             // cell moves
+    COUNT_GAIN_UPDATE,      // single gain changes
+    COUNT_BUCKET_INSERT,    // bucket list inserts
+    COUNT_BUCKET_REMOVE,    // bucket list removes
+    COUNT_NET_VISIT,        // cell list walks of critical nets
+    COUNT_NET_SKIP,         // critical net walks skipped (locked / large nets)
+    COUNT_ROLLBACK,         // moves undone after the best prefix
+    COUNT_MERGED_PIN,       // pins removed by merging duplicate nets
+    COUNT_LARGE_PIN,        // pins of the nets left out of the gains (per run)
+    COUNT_NUM
+};
+
+// one FM pass of the reported partitioner
+struct PassRecord
+{
+    int         pass;       // pass number in its run
+    double      seconds;    // wall-clock time of the pass
+    int         moveNum;    // cells moved
+    int         keptNum;    // moves kept (best prefix)
+    int         gain;       // cut improvement
+    int         cutSize;    // cut size after the pass
+};
+
+class Stats
+{
+public:
+    // Constructor and destructor
+    Stats() { clear(); }
+    ~Stats() { }
+
+    // Basic access methods
+    double getTime(const StatPhase p) const         { return _time[p]; }
+    long long getCount(const StatCounter c) const   { return _count[c]; }
+    const vector<PassRecord>& getPasses() const     { return _pass; }
+
+    // Modify methods
+    void addTime(const StatPhase p, const double seconds)   { _time[p] += seconds; }
+    void count(const StatCounter c, const long long n = 1)  { _count[c] += n; }
+    void addPass(const PassRecord& record)                  { _pass.push_back(record); }
+    // add the times and counters of a child run (its passes are not kept)
+    void merge(const Stats& other);
+    void clear();
+
+    // JSON report, or CSV when the file name ends in ".csv"
+    bool write(const char* fileName) const;
+
+private:
+    double              _time[PHASE_NUM];   // seconds spent in each phase
+    long long           _count[COUNT_NUM];  // value of each counter
+    vector<PassRecord>  _pass;              // passes of the reported run
+};
+
+// adds the wall-clock time of its scope to a phase
+class StatTimer
+{
+public:
+    StatTimer(Stats& stats, const StatPhase phase) :
+        _stats(stats), _phase(phase), _start(chrono::steady_clock::now()) { }
+    ~StatTimer() { _stats.addTime(_phase, seconds()); }
+
+    double seconds() const {
+        return chrono::duration<double>(chrono::steady_clock::now() - _start).count();
+    }
+
+private:
+    Stats&                              _stats;
+    StatPhase                           _phase;
+    chrono::steady_clock::time_point    _start;
+};
+
+#define STATS_CAT2(a, b)    a##b
+#define STATS_CAT(a, b)     STATS_CAT2(a, b)
+#ifdef FM_STATS
+#define STATS_TIMER(stats, phase)   StatTimer STATS_CAT(statTimer, __LINE__)((stats), (phase))
+#define STATS_COUNT(stats, c, n)    (stats).count((c), (n))
+#define STATS_RUN(...)              __VA_ARGS__
+#else
+#define STATS_TIMER(stats, phase)
+#define STATS_COUNT(stats, c, n)
+#define STATS_RUN(...)
+#endif
+
+#endif  // STATS_H